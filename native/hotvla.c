@@ -0,0 +1,394 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hotvla.h"
+#include "parallel.h"
+
+#define HO_MAX_MOMENT (2 * HO_MAX_ORDER)
+
+static const double ho_binom[HO_MAX_MOMENT + 1][HO_MAX_MOMENT + 1] = {
+    {1},
+    {1, 1},
+    {1, 2, 1},
+    {1, 3, 3, 1},
+    {1, 4, 6, 4, 1},
+    {1, 5, 10, 10, 5, 1},
+    {1, 6, 15, 20, 15, 6, 1},
+    {1, 7, 21, 35, 35, 21, 7, 1},
+    {1, 8, 28, 56, 70, 56, 28, 8, 1},
+};
+
+typedef struct ho_job_struct {
+    double *state;
+    int num_samples;        // S, or W for the pair accumulator
+    int order;
+    const sct_view *view;   // set: traces come from the view, traces is unused
+    const double *traces;
+    int num_traces;
+    const int *group;
+    const double *uni;      // pair accumulator: both groups' mean[W], M2[W] as they were before this update
+    int failed;             // set by a range that could not allocate its buffers
+} ho_job;
+
+// Trace r over columns [lo, hi): returns p with column j at p[j - lo], decoding view rows into scratch.
+static inline const double *ho_row(const ho_job *job, int r, int lo, int hi, double *scratch) {
+    if (!job->view)
+        return job->traces + (size_t)r * job->num_samples + lo;
+    sct_view_decode(job->view, (uint64_t)r, (uint32_t)lo, (uint32_t)hi, scratch);
+    return scratch;
+}
+
+/*
+* Central sums about the new mean after adding x as the n-th value. With a = -delta / n every old deviation shifts by
+* a, so M_p' = sum_k C(p, k) a^(p - k) M_k (M_0 = n - 1, M_1 = 0), plus the new value's own (delta (n - 1) / n)^p.
+* Highest p first, so the M_k it reads are still the old ones. mo = [mean, M2 .. M_P].
+*/
+static inline void ho_push(double *mo, int P, double x, double n) {
+    const double delta = x - mo[0];
+    const double a = -delta / n, u = delta * (n - 1.0) / n;
+    double u_pow[HO_MAX_MOMENT + 1];
+    u_pow[0] = 1.0;
+    for (int p = 1; p <= P; p++)
+        u_pow[p] = u_pow[p - 1] * u;
+    for (int p = P; p >= 2; p--) {
+        double s = 0.0, a_pow = 1.0;
+        for (int k = p; k >= 2; k--) {
+            s += ho_binom[p][k] * a_pow * mo[k - 1];
+            a_pow *= a;
+        }
+        mo[p - 1] = s + a_pow * a * (n - 1.0) + u_pow[p];
+    }
+    mo[0] += delta / n;
+}
+
+// Columns [lo, hi) for every trace; counts are replayed per range and committed by ho_run(), as in tvla.c.
+static void ho_range(void *ctx, int lo, int hi) {
+    const ho_job *job = ctx;
+    const int S = job->num_samples, P = 2 * job->order;
+    double scratch[SCA_BLOCK];
+    for (int blo = lo; blo < hi; blo += SCA_BLOCK) {
+        int bhi = blo + SCA_BLOCK < hi ? blo + SCA_BLOCK : hi;
+        double n[2] = {job->state[0], job->state[1]};
+        for (int r = 0; r < job->num_traces; r++) {
+            int g = job->group[r];
+            if (g != 0 && g != 1)
+                continue;
+            const double *x = ho_row(job, r, blo, bhi, scratch);
+            double cnt = ++n[g];
+            double *mo = job->state + 2 + ((size_t)g * S + blo) * P;
+            for (int j = 0; j < bhi - blo; j++, mo += P)
+                ho_push(mo, P, x[j], cnt);
+        }
+    }
+}
+
+static void ho_commit_counts(const ho_job *job) {
+    for (int r = 0; r < job->num_traces; r++) {
+        int g = job->group[r];
+        if (g == 0 || g == 1)
+            job->state[g] += 1.0;
+    }
+}
+
+static int ho_valid_order(int order) {
+    return order >= 1 && order <= HO_MAX_ORDER;
+}
+
+static void ho_run(ho_job *job, int num_threads) {
+    if (job->num_traces <= 0 || job->num_samples <= 0 || !ho_valid_order(job->order))
+        return;
+    sca_parallel_columns(job->num_samples, num_threads, ho_range, job);
+    ho_commit_counts(job);
+}
+
+void ho_update(double *state, const int *num_samples, const int *order, const double *traces, const int *num_traces,
+               const int *group, const int *num_threads) {
+    ho_job job = {state, *num_samples, *order, NULL, traces, *num_traces, group};
+    ho_run(&job, sca_num_threads(*num_threads));
+}
+
+void ho_update_view(double *state, int order, const sct_view *view, const int *group, int num_threads) {
+    ho_job job = {state, (int)view->num_samples, order, view, NULL, (int)view->num_rows, group};
+    ho_run(&job, sca_num_threads(num_threads));
+}
+
+/*
+* Both sides re-centred on the combined mean: A's deviations shift by -nb delta / n, B's by na delta / n, and the
+* same binomial expansion as ho_push() applies with M_0 = the side's count.
+*/
+void ho_merge(double *state, const double *other, const int *num_samples, const int *order) {
+    const int S = *num_samples, P = 2 * *order;
+    if (!ho_valid_order(*order))
+        return;
+    for (int g = 0; g < 2; g++) {
+        const double na = state[g], nb = other[g], n = na + nb;
+        if (nb == 0.0)
+            continue;
+        for (int j = 0; j < S; j++) {
+            double *ma = state + 2 + ((size_t)g * S + j) * P;
+            const double *mb = other + 2 + ((size_t)g * S + j) * P;
+            const double delta = mb[0] - ma[0];
+            const double sa = -nb * delta / n, sb = na * delta / n;
+            for (int p = P; p >= 2; p--) {
+                double s = 0.0, pa = 1.0, pb = 1.0;
+                for (int k = p; k >= 2; k--) {
+                    s += ho_binom[p][k] * (pa * ma[k - 1] + pb * mb[k - 1]);
+                    pa *= sa;
+                    pb *= sb;
+                }
+                ma[p - 1] = s + pa * sa * na + pb * sb * nb;
+            }
+            ma[0] += delta * nb / n;
+        }
+        state[g] = n;
+    }
+}
+
+// Mean and variance of the order-d statistic of one group (see hotvla.h); 0 if it is undefined.
+static int ho_moment_stat(const double *mo, double n, int d, double *mean, double *var) {
+    if (d == 1) {
+        *mean = mo[0];
+        *var = mo[1] / (n - 1.0);
+        return 1;
+    }
+    const double cm2 = mo[1] / n;
+    if (!(cm2 > 0.0))
+        return 0;
+    const double cm_d = mo[d - 1] / n, cm_2d = mo[2 * d - 1] / n;
+    if (d == 2) {
+        *mean = cm2;
+        *var = cm_2d - cm2 * cm2;
+    } else {
+        const double scale = pow(cm2, d);
+        *mean = cm_d / sqrt(scale);
+        *var = (cm_2d - cm_d * cm_d) / scale;
+    }
+    return 1;
+}
+
+void ho_tvalues(const double *state, const int *num_samples, const int *order, const int *test_order, double *t) {
+    const int S = *num_samples, P = 2 * *order, d = *test_order;
+    const double n0 = state[0], n1 = state[1];
+    for (int j = 0; j < S; j++) {
+        double mean0, var0, mean1, var1;
+        t[j] = NAN;
+        if (!ho_valid_order(*order) || d < 1 || d > *order || n0 < 2.0 || n1 < 2.0)
+            continue;
+        if (!ho_moment_stat(state + 2 + (size_t)j * P, n0, d, &mean0, &var0) ||
+            !ho_moment_stat(state + 2 + ((size_t)S + j) * P, n1, d, &mean1, &var1))
+            continue;
+        double se2 = var0 / n0 + var1 / n1;
+        if (se2 > 0.0)
+            t[j] = (mean0 - mean1) / sqrt(se2);
+    }
+}
+
+/*
+* Pair accumulator. Each range owns a slice of the pairs but needs every window sample's running mean and M2 (C20 /
+* C02), which change with each trace, so it replays their updates on a private copy of job->uni, the snapshot taken
+* before the ranges start. ho_pair_run() updates the shared mean and M2 once, after all ranges are done.
+*/
+static inline double *ho_pair_group(double *state, int W, int g) {
+    return state + 2 + (size_t)g * (2 * (size_t)W + 2 * (size_t)W * (W + 1));
+}
+
+static void ho_pair_range(void *ctx, int lo, int hi) {
+    ho_job *job = ctx;
+    const int W = job->num_samples;
+    double *uni = malloc(4 * (size_t)W * sizeof(double));  // per group: mean[W], M2[W]
+    double *scratch = job->view ? malloc((size_t)W * sizeof(double)) : NULL;
+    if (!uni || (job->view && !scratch)) {
+        free(uni);
+        free(scratch);
+        job->failed = 1;
+        return;
+    }
+    memcpy(uni, job->uni, 4 * (size_t)W * sizeof(double));
+    // first pair (i, j) of the range
+    int i0 = 0, j0 = lo;
+    while (j0 >= W - i0) {
+        j0 -= W - i0;
+        i0++;
+    }
+    j0 += i0;
+    double n[2] = {job->state[0], job->state[1]};
+    for (int r = 0; r < job->num_traces; r++) {
+        int g = job->group[r];
+        if (g != 0 && g != 1)
+            continue;
+        const double *x = ho_row(job, r, 0, W, scratch);
+        const double cnt = ++n[g], old = cnt - 1.0;
+        double *mean = uni + 2 * (size_t)g * W, *m2 = mean + W;
+        double *c = ho_pair_group(job->state, W, g) + 2 * (size_t)W + 4 * (size_t)lo;
+        for (int p = lo, i = i0, j = j0; p < hi; p++, c += 4) {
+            const double dx = x[i] - mean[i], dy = x[j] - mean[j];
+            const double a = -dx / cnt, b = -dy / cnt, u = dx * old / cnt, v = dy * old / cnt;
+            // C_ab' = sum_k,l C(a,k) C(b,l) a^(a-k) b^(b-l) C_kl + u^a v^b, C00 = n - 1, C10 = C01 = 0
+            const double c11 = c[0], c21 = c[1], c12 = c[2], c22 = c[3];
+            c[3] = c22 + 2.0 * b * c21 + 2.0 * a * c12 + b * b * m2[i] + a * a * m2[j] + 4.0 * a * b * c11 +
+                   a * a * b * b * old + u * u * v * v;
+            c[1] = c21 + b * m2[i] + 2.0 * a * c11 + a * a * b * old + u * u * v;
+            c[2] = c12 + a * m2[j] + 2.0 * b * c11 + a * b * b * old + u * v * v;
+            c[0] = c11 + a * b * old + u * v;
+            if (++j == W) {
+                i++;
+                j = i;
+            }
+        }
+        for (int k = 0; k < W; k++) {
+            const double d = x[k] - mean[k];
+            mean[k] += d / cnt;
+            m2[k] += d * (x[k] - mean[k]);
+        }
+    }
+    free(uni);
+    free(scratch);
+}
+
+/*
+* SCT_OK, or SCT_ERR_NOMEM. A range that failed to allocate leaves its pairs behind the others, so the counts are set
+* to NaN and every t-value of the state comes out NaN instead of silently wrong.
+*/
+static int ho_pair_run(ho_job *job, int num_threads) {
+    if (job->num_traces <= 0 || job->num_samples <= 0)
+        return SCT_OK;
+    const int W = job->num_samples;
+    double *uni = malloc(4 * (size_t)W * sizeof(double));
+    double *scratch = job->view ? malloc((size_t)W * sizeof(double)) : NULL;
+    if (!uni || (job->view && !scratch)) {
+        free(uni);
+        free(scratch);
+        return SCT_ERR_NOMEM;
+    }
+    for (int g = 0; g < 2; g++)
+        memcpy(uni + 2 * (size_t)g * W, ho_pair_group(job->state, W, g), 2 * (size_t)W * sizeof(double));
+    job->uni = uni;
+    job->failed = 0;
+    sca_parallel_columns(W * (W + 1) / 2, num_threads, ho_pair_range, job);
+
+    if (job->failed) {
+        job->state[0] = job->state[1] = NAN;
+    } else {
+        double n[2] = {job->state[0], job->state[1]};
+        for (int r = 0; r < job->num_traces; r++) {
+            int g = job->group[r];
+            if (g != 0 && g != 1)
+                continue;
+            const double *x = ho_row(job, r, 0, W, scratch);
+            const double cnt = ++n[g];
+            double *mean = ho_pair_group(job->state, W, g), *m2 = mean + W;
+            for (int k = 0; k < W; k++) {
+                const double d = x[k] - mean[k];
+                mean[k] += d / cnt;
+                m2[k] += d * (x[k] - mean[k]);
+            }
+        }
+        ho_commit_counts(job);
+    }
+    free(uni);
+    free(scratch);
+    return job->failed ? SCT_ERR_NOMEM : SCT_OK;
+}
+
+void ho_pair_update(double *state, const int *window, const double *traces, const int *num_traces, const int *group,
+                    const int *num_threads) {
+    ho_job job = {state, *window, 2, NULL, traces, *num_traces, group};
+    ho_pair_run(&job, sca_num_threads(*num_threads));
+}
+
+int ho_pair_update_view(double *state, const sct_view *view, const int *group, int num_threads) {
+    ho_job job = {state, (int)view->num_samples, 2, view, NULL, (int)view->num_rows, group};
+    return ho_pair_run(&job, sca_num_threads(num_threads));
+}
+
+void ho_pair_tvalues(const double *state, const int *window, double *t) {
+    const int W = *window;
+    const double n0 = state[0], n1 = state[1];
+    const double *c0 = ho_pair_group((double *)state, W, 0) + 2 * (size_t)W;
+    const double *c1 = ho_pair_group((double *)state, W, 1) + 2 * (size_t)W;
+    for (int i = 0, p = 0; i < W; i++)
+        for (int j = i; j < W; j++, p++) {
+            double tv = NAN;
+            if (n0 >= 2.0 && n1 >= 2.0) {
+                double mean0 = c0[4 * p] / n0, var0 = c0[4 * p + 3] / n0 - mean0 * mean0;
+                double mean1 = c1[4 * p] / n1, var1 = c1[4 * p + 3] / n1 - mean1 * mean1;
+                double se2 = var0 / n0 + var1 / n1;
+                if (se2 > 0.0)
+                    tv = (mean0 - mean1) / sqrt(se2);
+            }
+            t[(size_t)i * W + j] = t[(size_t)j * W + i] = tv;
+        }
+}
+
+// Shared setup of the store entry points: map, window, fixed / random groups. Returns an sct_status.
+static int ho_open_window(sct_map *m, sct_view *view, int **group, const char *path, int qs, int qe, double v,
+                          int *counts) {
+    int status = sct_map_open(m, path);
+    if (status != SCT_OK)
+        return status;
+    if (qs < 1 || qe < qs)
+        status = SCT_ERR_RANGE;
+    else
+        status = sct_view_window(view, m, (uint32_t)(qs - 1), (uint32_t)(qe - qs + 1));
+    if (status == SCT_OK && !(*group = malloc((size_t)view->num_rows * sizeof(int))))
+        status = SCT_ERR_NOMEM;
+    if (status != SCT_OK) {
+        sct_map_close(m);
+        return status;
+    }
+    // fixed: first input == v, as inputs[,1] == v in the R scripts
+    counts[0] = counts[1] = 0;
+    for (uint64_t r = 0; r < view->num_rows; r++) {
+        (*group)[r] = m->inputs[r * m->header.num_inputs] == v ? 0 : 1;
+        counts[(*group)[r]]++;
+    }
+    return SCT_OK;
+}
+
+void sct_ho_window(const char **path, const int *qs, const int *qe, const double *v, const int *order,
+                   const int *num_threads, double *t, int *counts, int *status) {
+    sct_map m;
+    sct_view view;
+    int *group = NULL;
+    if (!ho_valid_order(*order)) {
+        *status = SCT_ERR_RANGE;
+        return;
+    }
+    *status = ho_open_window(&m, &view, &group, *path, *qs, *qe, *v, counts);
+    if (*status != SCT_OK)
+        return;
+    const int W = (int)view.num_samples;
+    double *state = calloc(HO_STATE_SIZE(W, *order), sizeof(double));
+    if (!state) {
+        *status = SCT_ERR_NOMEM;
+    } else {
+        ho_update_view(state, *order, &view, group, *num_threads);
+        for (int d = 1; d <= *order; d++)
+            ho_tvalues(state, &W, order, &d, t + (size_t)(d - 1) * W);
+    }
+    free(state);
+    free(group);
+    sct_map_close(&m);
+}
+
+void sct_ho_pair_window(const char **path, const int *qs, const int *qe, const double *v, const int *num_threads,
+                        double *t, int *counts, int *status) {
+    sct_map m;
+    sct_view view;
+    int *group = NULL;
+    *status = ho_open_window(&m, &view, &group, *path, *qs, *qe, *v, counts);
+    if (*status != SCT_OK)
+        return;
+    const int W = (int)view.num_samples;
+    double *state = calloc(HO_PAIR_STATE_SIZE(W), sizeof(double));
+    if (!state) {
+        *status = SCT_ERR_NOMEM;
+    } else {
+        *status = ho_pair_update_view(state, &view, group, *num_threads);
+        ho_pair_tvalues(state, &W, t);
+    }
+    free(state);
+    free(group);
+    sct_map_close(&m);
+}
@@ -0,0 +1,68 @@
+/*
+ * Higher-order TVLA for the masked modes (scmd 2-5), in one pass over the traces.
+ *
+ * A first-order mask hides the mean but not the higher central moments. The univariate accumulator keeps, per group
+ * and sample, the mean and the central sums M_p = sum (x - mean)^p for p = 2 .. 2 * order. They are updated one trace
+ * at a time with Pebay's binomial recurrence, so the N x S matrix is never preprocessed. The order-d test then
+ * compares, per sample (Schneider & Moradi, CHES 2015):
+ *   d = 1   the means (plain Welch TVLA, identical to tvla.h)
+ *   d = 2   the variances CM2, whose own variance is CM4 - CM2^2
+ *   d >= 3  the standardized moments CM_d / CM2^(d/2), with variance (CM_2d - CM_d^2) / CM2^d
+ * with CM_p = M_p / n.
+ *
+ * The bivariate mode is for masks whose shares leak at two different samples. Over a window of W samples it
+ * accumulates, for every pair i <= j, the co-moment sums C_ab = sum (x_i - mean_i)^a (x_j - mean_j)^b for
+ * a, b <= 2. The test compares the centered product (x_i - mean_i)(x_j - mean_j): its mean is C11 / n and its variance
+ * C22 / n - (C11 / n)^2. That is W (W + 1) / 2 pairs of 4 sums per group, so keep W in the hundreds.
+ *
+ * Groups, conventions and threading are those of tvla.h: group 0 is fixed, 1 is random, anything else is skipped.
+ * Traces are row-major and scalars are passed by pointer for R's .C().
+ */
+#ifndef HOTVLA_H
+#define HOTVLA_H
+
+#include <stddef.h>
+
+#include "tracemap.h"
+
+#define HO_MAX_ORDER 4
+
+/*
+ * Univariate state: [n0, n1, then for group g and sample j the 2 * order values mean, M2 .. M_(2 * order)]
+ * at 2 + (g * S + j) * 2 * order.
+ */
+#define HO_STATE_SIZE(S, order) (2 + 4 * (size_t)(S) * (size_t)(order))
+
+void ho_update(double *state, const int *num_samples, const int *order, const double *traces, const int *num_traces,
+               const int *group, const int *num_threads);
+void ho_update_view(double *state, int order, const sct_view *view, const int *group, int num_threads);
+// state += other (Pebay's pairwise combination), e.g. accumulators built from separate capture runs.
+void ho_merge(double *state, const double *other, const int *num_samples, const int *order);
+// Order-test_order t per sample (1 <= test_order <= order); NaN where a group has < 2 traces or the variance is 0.
+void ho_tvalues(const double *state, const int *num_samples, const int *order, const int *test_order, double *t);
+
+/*
+ * Bivariate state over a window of W samples: [n0, n1, then per group: mean[W], M2[W], and for each pair i <= j
+ * (row-major upper triangle) C11, C21, C12, C22].
+ */
+#define HO_PAIR_STATE_SIZE(W) (2 + 2 * (2 * (size_t)(W) + 2 * (size_t)(W) * ((size_t)(W) + 1)))
+
+// traces are num_traces x W: the window's columns only.
+void ho_pair_update(double *state, const int *window, const double *traces, const int *num_traces, const int *group,
+                    const int *num_threads);
+// SCT_OK or SCT_ERR_NOMEM; after a failure every t-value of the state is NaN.
+int ho_pair_update_view(double *state, const sct_view *view, const int *group, int num_threads);
+// Centered-product t of every pair as a symmetric W x W matrix (the diagonal is the univariate order-2 test).
+void ho_pair_tvalues(const double *state, const int *window, double *t);
+
+/*
+ * Straight from a trace store, fixed = rows whose first input is v, window [qs, qe] (1-based, inclusive).
+ * sct_ho_window gives every test order 1 .. order: t is order x W, row d - 1 holding order d.
+ * sct_ho_pair_window gives the W x W pair matrix. counts gets the group sizes, status an sct_status.
+ */
+void sct_ho_window(const char **path, const int *qs, const int *qe, const double *v, const int *order,
+                   const int *num_threads, double *t, int *counts, int *status);
+void sct_ho_pair_window(const char **path, const int *qs, const int *qe, const double *v, const int *num_threads,
+                        double *t, int *counts, int *status);
+
+#endif
@@ -0,0 +1,250 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ks.h"
+#include "parallel.h"
+#include "tracemap.h"
+
+#define KS_COLS 32              // columns gathered per pass: KS_COLS x N codes stay cache-resident
+#define KS_NUM_CODES 65536      // every int16 code, so a histogram never needs resizing
+
+typedef struct ks_job_struct {
+    const sct_view *view;       // set: group rows are store rows, fixed / random are unused
+    const int32_t *fixed_rows;
+    const int32_t *random_rows;
+    const double *fixed;
+    const double *random;
+    int dtype;                  // SCT_I16 / SCT_F32 for a view, 0 for the double matrices
+    int num_fixed;              // rows of each group used by the last step
+    int num_random;
+    int num_samples;
+    const int *m;               // checkpoints (both groups use the first m[k] rows); NULL: one step, all rows
+    int num_steps;
+    double *D;                  // num_steps x num_samples
+} ks_job;
+
+static inline const void *ks_row(const ks_job *job, int g, int r) {
+    if (job->view)
+        return sct_view_data(job->view, (uint64_t)(g ? job->random_rows : job->fixed_rows)[r]);
+    return (g ? job->random : job->fixed) + (size_t)r * job->num_samples;
+}
+
+static inline double ks_value(const ks_job *job, const void *row, int j) {
+    if (job->dtype == SCT_I16)
+        return ((const int16_t *)row)[j];
+    if (job->dtype == SCT_F32)
+        return ((const float *)row)[j];
+    return ((const double *)row)[j];
+}
+
+// ADC code of x (x = code / 1024 - 0.5); 0 if x is not one (NaN included).
+static inline int ks_code(double x, int16_t *code) {
+    double c = (x + 0.5) * 1024.0;
+    if (!(c >= -32768.0 && c <= 32767.0) || c != (int)c)
+        return 0;
+    *code = (int16_t)c;
+    return 1;
+}
+
+static void ks_step_sizes(const ks_job *job, int k, int *nf, int *nr) {
+    *nf = job->m ? job->m[k] : job->num_fixed;
+    *nr = job->m ? job->m[k] : job->num_random;
+}
+
+/*
+* Rows of both groups, columns [j0, j0 + w), as codes: column c at codes[c * n], fixed rows first. int16 stores are
+* already codes - D does not change under the monotone decode. ok[c] is cleared for a column holding a non-code value.
+*/
+static void ks_gather(const ks_job *job, int j0, int w, int16_t *codes, int *ok) {
+    const int n = job->num_fixed + job->num_random;
+    for (int c = 0; c < w; c++)
+        ok[c] = 1;
+    for (int g = 0; g < 2; g++) {
+        const int rows = g ? job->num_random : job->num_fixed;
+        const int base = g ? job->num_fixed : 0;
+        for (int r = 0; r < rows; r++) {
+            const void *row = ks_row(job, g, r);
+            if (job->dtype == SCT_I16) {
+                const int16_t *x = (const int16_t *)row + j0;
+                for (int c = 0; c < w; c++)
+                    codes[c * n + base + r] = x[c];
+            } else {
+                for (int c = 0; c < w; c++)
+                    ok[c] &= ks_code(ks_value(job, row, j0 + c), &codes[c * n + base + r]);
+            }
+        }
+    }
+}
+
+/*
+* Histogram path: count each group's codes over [min, max] of the column and walk the bins. Each bin holds every copy
+* of a value, so the CDFs are compared only after a run of ties, as ks.test() does. For the power curve the counts are
+* extended by the rows between checkpoints.
+*/
+static void ks_column_hist(const ks_job *job, const int16_t *codes, int32_t *hist_f, int32_t *hist_r, int j) {
+    const int n = job->num_fixed + job->num_random;
+    int lo = INT16_MAX, hi = INT16_MIN;
+    for (int i = 0; i < n; i++) {
+        if (codes[i] < lo)
+            lo = codes[i];
+        if (codes[i] > hi)
+            hi = codes[i];
+    }
+    const int bins = hi - lo + 1;
+    memset(hist_f, 0, (size_t)bins * sizeof(int32_t));
+    memset(hist_r, 0, (size_t)bins * sizeof(int32_t));
+    const int16_t *cf = codes, *cr = codes + job->num_fixed;
+    int have_f = 0, have_r = 0;
+    for (int k = 0; k < job->num_steps; k++) {
+        int nf, nr;
+        ks_step_sizes(job, k, &nf, &nr);
+        for (; have_f < nf; have_f++)
+            hist_f[cf[have_f] - lo]++;
+        for (; have_r < nr; have_r++)
+            hist_r[cr[have_r] - lo]++;
+        double d = NAN;
+        if (nf > 0 && nr > 0) {
+            const double inv_f = 1.0 / nf, inv_r = 1.0 / nr;
+            int64_t sf = 0, sr = 0;
+            d = 0.0;
+            for (int b = 0; b < bins; b++) {
+                sf += hist_f[b];
+                sr += hist_r[b];
+                double e = fabs(sf * inv_f - sr * inv_r);
+                if (e > d)
+                    d = e;
+            }
+        }
+        job->D[(size_t)k * job->num_samples + j] = d;
+    }
+}
+
+static int ks_cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Non-NaN values of the first n rows of group g, column j, sorted; returns how many.
+static int ks_sorted_column(const ks_job *job, int g, int n, int j, double *out) {
+    int k = 0;
+    for (int r = 0; r < n; r++) {
+        double x = ks_value(job, ks_row(job, g, r), j);
+        if (!isnan(x))
+            out[k++] = x;
+    }
+    qsort(out, (size_t)k, sizeof(double), ks_cmp_double);
+    return k;
+}
+
+// Sort path for a column that is not ADC codes: merge walk over the distinct values of both sorted groups.
+static void ks_column_sort(const ks_job *job, double *xf, double *xr, int j) {
+    for (int k = 0; k < job->num_steps; k++) {
+        int nf, nr;
+        ks_step_sizes(job, k, &nf, &nr);
+        nf = ks_sorted_column(job, 0, nf, j, xf);
+        nr = ks_sorted_column(job, 1, nr, j, xr);
+        double d = NAN;
+        if (nf > 0 && nr > 0) {
+            int a = 0, b = 0;
+            d = 0.0;
+            while (a < nf && b < nr) {
+                double z = xf[a] < xr[b] ? xf[a] : xr[b];
+                while (a < nf && xf[a] == z)
+                    a++;
+                while (b < nr && xr[b] == z)
+                    b++;
+                double e = fabs((double)a / nf - (double)b / nr);
+                if (e > d)
+                    d = e;
+            }
+        }
+        job->D[(size_t)k * job->num_samples + j] = d;
+    }
+}
+
+static void ks_range(void *ctx, int lo, int hi) {
+    const ks_job *job = ctx;
+    const int n = job->num_fixed + job->num_random;
+    int16_t *codes = malloc((size_t)KS_COLS * n * sizeof(int16_t));
+    int32_t *hist = malloc(2 * KS_NUM_CODES * sizeof(int32_t));
+    double *sorted = malloc((size_t)n * sizeof(double));
+    if (!codes || !hist || !sorted) {
+        for (int k = 0; k < job->num_steps; k++)
+            for (int j = lo; j < hi; j++)
+                job->D[(size_t)k * job->num_samples + j] = NAN;
+    } else {
+        int ok[KS_COLS];
+        for (int j0 = lo; j0 < hi; j0 += KS_COLS) {
+            const int w = hi - j0 < KS_COLS ? hi - j0 : KS_COLS;
+            ks_gather(job, j0, w, codes, ok);
+            for (int c = 0; c < w; c++) {
+                if (ok[c])
+                    ks_column_hist(job, codes + (size_t)c * n, hist, hist + KS_NUM_CODES, j0 + c);
+                else
+                    ks_column_sort(job, sorted, sorted + job->num_fixed, j0 + c);
+            }
+        }
+    }
+    free(codes);
+    free(hist);
+    free(sorted);
+}
+
+void ks_stat(const double *fixed, const int *num_fixed, const double *random, const int *num_random,
+             const int *num_samples, const int *num_threads, double *D) {
+    ks_job job = {NULL, NULL, NULL, fixed, random, 0, *num_fixed, *num_random, *num_samples, NULL, 1, D};
+    sca_parallel_columns(job.num_samples, sca_num_threads(*num_threads), ks_range, &job);
+}
+
+void ks_power_curve(const double *fixed, const int *num_fixed, const double *random, const int *num_random,
+                    const int *num_samples, const int *m, const int *num_steps, const int *num_threads, double *D) {
+    const int S = *num_samples, K = *num_steps;
+    int valid = K > 0;
+    for (int k = 0; valid && k < K; k++)
+        valid = m[k] >= 0 && m[k] <= *num_fixed && m[k] <= *num_random && (k == 0 || m[k] >= m[k - 1]);
+    if (!valid) {
+        for (size_t i = 0; i < (size_t)K * S; i++)
+            D[i] = NAN;
+        return;
+    }
+    // only the first m[K - 1] rows of each group are ever counted
+    ks_job job = {NULL, NULL, NULL, fixed, random, 0, m[K - 1], m[K - 1], S, m, K, D};
+    sca_parallel_columns(S, sca_num_threads(*num_threads), ks_range, &job);
+}
+
+void sct_ks_window(const char **path, const int *qs, const int *qe, const double *v, const int *num_threads,
+                   double *D, int *counts, int *status) {
+    sct_map m;
+    sct_view view;
+    *status = sct_map_open(&m, *path);
+    if (*status != SCT_OK)
+        return;
+    if (*qs < 1 || *qe < *qs)
+        *status = SCT_ERR_RANGE;
+    else
+        *status = sct_view_window(&view, &m, (uint32_t)(*qs - 1), (uint32_t)(*qe - *qs + 1));
+    int32_t *rows = NULL;
+    if (*status == SCT_OK) {
+        rows = malloc((size_t)view.num_rows * sizeof(int32_t));
+        if (!rows)
+            *status = SCT_ERR_NOMEM;
+    }
+    if (*status == SCT_OK) {
+        // fixed: first input == v, as inputs[,1] == v in the R scripts; rows holds the fixed rows, then the random
+        int nf = 0, nr = 0;
+        for (uint64_t r = 0; r < view.num_rows; r++)
+            if (m.inputs[r * m.header.num_inputs] == *v)
+                rows[nf++] = (int32_t)r;
+        for (uint64_t r = 0; r < view.num_rows; r++)
+            if (m.inputs[r * m.header.num_inputs] != *v)
+                rows[nf + nr++] = (int32_t)r;
+        ks_job job = {&view, rows, rows + nf, NULL, NULL, (int)m.header.dtype, nf, nr,
+                      (int)view.num_samples, NULL, 1, D};
+        sca_parallel_columns(job.num_samples, sca_num_threads(*num_threads), ks_range, &job);
+        counts[0] = nf;
+        counts[1] = nr;
+    }
+    free(rows);
+    sct_map_close(&m);
+}
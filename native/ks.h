@@ -0,0 +1,34 @@
+/*
+ * Two-sample Kolmogorov-Smirnov D per sample column (KSLA).
+ *
+ * ChipWhisperer samples are 10-bit ADC codes (code / 1024 - 0.5), so a column is counted into a histogram of codes and
+ * D is one walk over the occupied code range - no sorting, and ties fall out of the histogram exactly as
+ * ks.test()'s tie-aware statistic treats them. A column that is not plain ADC codes (or holds NaN) falls back to
+ * sorting both groups and a merge walk over the distinct values; NaN are dropped first, as ks.test() does.
+ *
+ * Traces are row-major (trace r, sample j at [r * S + j]) and scalars are passed by pointer for R's .C(), as in
+ * tvla.h.
+ */
+#ifndef KS_H
+#define KS_H
+
+// D per column of fixed vs random; NaN where a group is empty.
+void ks_stat(const double *fixed, const int *num_fixed, const double *random, const int *num_random,
+             const int *num_samples, const int *num_threads, double *D);
+
+/*
+ * Incremental D for the power curve: D of every column using the first m[k] traces of each group, for every checkpoint
+ * m[0] <= ... <= min(num_fixed, num_random). The histograms are extended between checkpoints rather than rebuilt.
+ * D is num_steps x num_samples, row-major (row k = checkpoint k); all NaN if the checkpoints are invalid.
+ */
+void ks_power_curve(const double *fixed, const int *num_fixed, const double *random, const int *num_random,
+                    const int *num_samples, const int *m, const int *num_steps, const int *num_threads, double *D);
+
+/*
+ * KSLA straight from a trace store: window [qs, qe] (1-based, inclusive), fixed = rows whose first input is v. int16
+ * stores are counted on their raw codes. counts gets the group sizes, status an sct_status.
+ */
+void sct_ks_window(const char **path, const int *qs, const int *qe, const double *v, const int *num_threads,
+                   double *D, int *counts, int *status);
+
+#endif
@@ -0,0 +1,147 @@
+"""
+Live TVLA while a campaign is being captured, with early stopping.
+
+    live = LiveTVLA(num_samples=24430, v=2, max_traces=num_traces)
+    for ...:
+        wave = capture_trace(...)
+        live.push(wave, first_val)
+        if live.done:
+            break
+    print(live.verdict, live.summary())
+
+Each trace goes straight into per-sample Welch accumulators (sca.TvlaAccumulator when libsca.so is built, NumPy
+otherwise), so max |t| is current after every trace. Every check_every traces the stopping rule is evaluated:
+
+  leak      max |t| > threshold with at least min_per_group traces per group, on `confirm` consecutive checks
+            (a single excursion over 4.5 across ~24k samples is not yet a verdict)
+  no-leak   max_traces reached without that
+
+With ks_threshold set, the check also computes the per-sample KS D over the traces pushed so far (kept in memory,
+as the capture notebook keeps them anyway), and D > ks_threshold counts as a leak as well. That part needs libsca.so.
+"""
+from typing import List, Optional
+
+import numpy as np
+
+try:
+    import sca
+except ImportError:  # running from a copy without the bindings
+    sca = None
+
+
+class _NumpyWelford:
+    """
+    Fallback accumulator with the same interface as sca.TvlaAccumulator, one trace at a time.
+    """
+
+    def __init__(self, num_samples: int):
+        self.n = [0, 0]
+        self.mean = np.zeros((2, num_samples))
+        self.m2 = np.zeros((2, num_samples))
+
+    @property
+    def counts(self):
+        return self.n[0], self.n[1]
+
+    def update(self, trace: np.ndarray, group: int):
+        self.n[group] += 1
+        d = trace - self.mean[group]
+        self.mean[group] += d / self.n[group]
+        self.m2[group] += d * (trace - self.mean[group])
+        return self
+
+    def tvalues(self) -> np.ndarray:
+        n0, n1 = self.n
+        if n0 < 2 or n1 < 2:
+            return np.full(self.mean.shape[1], np.nan)
+        se2 = self.m2[0] / (n0 * (n0 - 1)) + self.m2[1] / (n1 * (n1 - 1))
+        with np.errstate(divide="ignore", invalid="ignore"):
+            return np.where(se2 > 0, (self.mean[0] - self.mean[1]) / np.sqrt(se2), np.nan)
+
+
+class LiveTVLA:
+    def __init__(
+        self,
+        num_samples: int,
+        v: float = 0.5,
+        threshold: float = 4.5,
+        min_per_group: int = 50,
+        max_traces: Optional[int] = None,
+        check_every: int = 50,
+        confirm: int = 2,
+        ks_threshold: Optional[float] = None,
+    ):
+        self.num_samples = int(num_samples)
+        self.v = v
+        self.threshold = threshold
+        self.min_per_group = min_per_group
+        self.max_traces = max_traces
+        self.check_every = max(1, int(check_every))
+        self.confirm = max(1, int(confirm))
+        self.ks_threshold = ks_threshold
+        native = sca is not None and sca.available()
+        if ks_threshold is not None and not native:
+            raise ValueError("live KS needs libsca.so - run `make -C native` or drop ks_threshold")
+        # one trace per update is too little work to spread over threads
+        self.acc = sca.TvlaAccumulator(self.num_samples, threads=1) if native else _NumpyWelford(self.num_samples)
+        self._native = native
+        self._kept: List[List[np.ndarray]] = [[], []]
+        self._over = 0
+        self.pushed = 0
+        self.max_abs_t = np.nan
+        self.max_t_at = -1
+        self.max_D = np.nan
+        self.verdict: Optional[str] = None    # None while running, then "leak" or "no-leak"
+        self.history = []                     # (traces, n_fixed, n_random, max |t|, max D) per check
+
+    @property
+    def done(self) -> bool:
+        return self.verdict is not None
+
+    @property
+    def counts(self):
+        return self.acc.counts
+
+    def push(self, trace, first_input: float) -> bool:
+        """
+        Add one captured trace; its group is fixed when first_input == v. Returns True once the campaign can stop.
+        """
+        x = np.asarray(trace, dtype=np.float64).ravel()
+        if x.size != self.num_samples:
+            raise ValueError(f"expected {self.num_samples} samples, got {x.size}")
+        g = 0 if first_input == self.v else 1
+        self.acc.update(x[None, :] if self._native else x, g)
+        if self.ks_threshold is not None:
+            self._kept[g].append(x)
+        self.pushed += 1
+
+        t = self.acc.tvalues()
+        if np.isfinite(t).any():
+            self.max_t_at = int(np.nanargmax(np.abs(t)))
+            self.max_abs_t = float(np.abs(t[self.max_t_at]))
+        if self.verdict is None and self.pushed % self.check_every == 0:
+            self._check()
+        if self.verdict is None and self.max_traces is not None and self.pushed >= self.max_traces:
+            self.verdict = "no-leak"
+        return self.done
+
+    def _check(self):
+        n0, n1 = self.counts
+        if self.ks_threshold is not None and min(n0, n1) > 0:
+            D = sca.ks_dcurve(np.vstack(self._kept[0]), np.vstack(self._kept[1]))
+            self.max_D = float(np.nanmax(D)) if np.isfinite(D).any() else np.nan
+        self.history.append((self.pushed, n0, n1, self.max_abs_t, self.max_D))
+        if min(n0, n1) < self.min_per_group:
+            return
+        leaking = self.max_abs_t > self.threshold or (
+            self.ks_threshold is not None and self.max_D > self.ks_threshold)
+        self._over = self._over + 1 if leaking else 0
+        if self._over >= self.confirm:
+            self.verdict = "leak"
+
+    def summary(self) -> str:
+        n0, n1 = self.counts
+        s = f"{self.pushed} traces ({n0} fixed / {n1} random), max |t| = {self.max_abs_t:.2f} at sample {self.max_t_at + 1}"
+        if self.ks_threshold is not None:
+            s += f", max D = {self.max_D:.3f}"
+        return s + (f" -> {self.verdict}" if self.verdict else "")
@@ -0,0 +1,132 @@
+"""
+Layer / neuron markers of a TRACE_MARKERS firmware build (network/markers.h) - which samples belong to which
+operation of the forward pass. Pure NumPy.
+
+    names = slot_names([7, 5, 4, 3])              # NET_NUM_NEURONS of the config the firmware was built with
+    payload = target.simpleserial_read('r', response_len(names))
+    stamps[i] = parse_response(payload, names)    # cycles since trigger_high(), one per slot
+    ...
+    win = windows(stamps, names, samples_per_cycle=4 / decimate_value)
+    qs, qe = win["L1N0"]                          # every sample of layer 1, neuron 0 in any trace
+    op_at(stamps, names, 5234)                    # "L2N3" - what a TVLA peak at sample 5234 is
+
+Slots are "L<l>" (layer l starts, before its first neuron - masks, quantization and the layer jitter), "L<l>N<j>"
+(neuron j of layer l, 0-based like the firmware) and "end" (the last operation is finished). An operation's window
+runs from its stamp to the next stamp in time. MARKER_NONE (a slot the mode does not stamp) reads as -1.
+
+Sample = cycles x samples_per_cycle: the CW-Lite samples at 4x the target clock (adc_src "clkgen_x4"), divided by
+scope.adc.decimate and by any sct-prep -d. offset is scope.adc.offset. Jitter and shuffling move the operations from
+trace to trace; windows() covers all of them, so the windows of a shuffled mode overlap.
+"""
+import csv
+import warnings
+from pathlib import Path
+from typing import Dict, List, Sequence, Tuple, Union
+
+import numpy as np
+
+MARKER_NONE = 0xFFFFFFFF
+MARKERS_MAX = 61
+
+PathLike = Union[str, Path]
+
+
+def slot_names(num_neurons: Sequence[int]) -> List[str]:
+    """
+    Slot names in firmware order for a topology given as NET_NUM_NEURONS (input layer first).
+    """
+    names = []
+    for l in range(1, len(num_neurons)):
+        names.append(f"L{l}")
+        names.extend(f"L{l}N{j}" for j in range(num_neurons[l]))
+    names.append("end")
+    if len(names) > MARKERS_MAX:
+        raise ValueError(f"{len(names)} slots, one response holds {MARKERS_MAX}")
+    return names
+
+
+def response_len(names: Sequence[str]) -> int:
+    """Payload length of the 'r' response: the echoed float, then one uint32 per slot."""
+    return 4 + 4 * len(names)
+
+
+def parse_response(payload, names: Sequence[str]) -> np.ndarray:
+    """
+    The stamps of one 'r' response as int64 cycles, -1 for MARKER_NONE.
+    """
+    raw = bytes(payload)
+    if len(raw) != response_len(names):
+        raise ValueError(f"expected {response_len(names)} bytes, got {len(raw)} - firmware built without "
+                         f"TRACE_MARKERS or for another topology?")
+    s = np.frombuffer(raw, dtype="<u4", offset=4).astype(np.int64)
+    s[s == MARKER_NONE] = -1
+    return s
+
+
+def write_csv(path: PathLike, stamps: np.ndarray, names: Sequence[str]) -> Path:
+    """One row per trace (1-based, same order as the store), NA for unstamped slots - read_markers() in markers.R."""
+    path = Path(path)
+    with open(path, "w", newline="") as f:
+        w = csv.writer(f)
+        w.writerow(["trace"] + list(names))
+        for r, row in enumerate(np.asarray(stamps)):
+            w.writerow([r + 1] + [int(v) if v >= 0 else "NA" for v in row])
+    return path
+
+
+def read_csv(path: PathLike) -> Tuple[np.ndarray, List[str]]:
+    with open(path, newline="") as f:
+        rows = list(csv.reader(f))
+    names = rows[0][1:]
+    stamps = np.array([[int(v) if v != "NA" else -1 for v in row[1:]] for row in rows[1:]], dtype=np.int64)
+    return stamps.reshape(-1, len(names)), names
+
+
+def _spans(stamps: np.ndarray) -> Tuple[np.ndarray, np.ndarray]:
+    """
+    Per trace and slot, the cycle the operation starts and the next stamp after it (-1 where not stamped / last).
+    """
+    stamps = np.atleast_2d(np.asarray(stamps, dtype=np.int64))
+    start = stamps
+    end = np.full_like(stamps, -1)
+    for r, row in enumerate(stamps):
+        valid = np.flatnonzero(row >= 0)
+        order = valid[np.argsort(row[valid], kind="stable")]
+        end[r, order[:-1]] = row[order[1:]]
+    return start, end
+
+
+def windows(stamps: np.ndarray, names: Sequence[str], samples_per_cycle: float = 4.0, offset: int = 0,
+            pad: int = 0) -> Dict[str, Tuple[int, int]]:
+    """
+    name -> (qs, qe), the 1-based inclusive sample window holding that operation in every trace, widened by pad
+    samples on each side. Slots never stamped, and "end", are left out. Clip qe to the trace length yourself.
+    """
+    start, end = _spans(stamps)
+    out = {}
+    for s, name in enumerate(names):
+        ok = (start[:, s] >= 0) & (end[:, s] >= 0)
+        if not ok.any():
+            continue
+        first = int(np.floor(start[ok, s].min() * samples_per_cycle)) - offset
+        last = int(np.ceil(end[ok, s].max() * samples_per_cycle)) - offset
+        out[name] = (max(1, first + 1 - pad), max(1, last + pad))
+    return out
+
+
+def op_at(stamps: np.ndarray, names: Sequence[str], sample: int, samples_per_cycle: float = 4.0,
+          offset: int = 0) -> str:
+    """
+    The operation running at a 1-based sample index, from the median stamps over all traces; "" outside the
+    forward pass.
+    """
+    start, end = _spans(stamps)
+    with warnings.catch_warnings():
+        warnings.simplefilter("ignore", RuntimeWarning)     # all-NaN columns: slots the mode does not stamp
+        med_start = np.nanmedian(np.where(start >= 0, start, np.nan), axis=0)
+        med_end = np.nanmedian(np.where(end >= 0, end, np.nan), axis=0)
+    cycle = (sample - 1 + offset) / samples_per_cycle
+    for s, name in enumerate(names):
+        if med_start[s] <= cycle < med_end[s]:
+            return name
+    return ""
@@ -0,0 +1,65 @@
+#include <pthread.h>
+#include <unistd.h>
+
+#include "parallel.h"
+
+#define SCA_MAX_THREADS 64
+
+typedef struct sca_job_struct {
+    sca_range_fn fn;
+    void *ctx;
+    int lo;
+    int hi;
+} sca_job;
+
+static void *sca_job_run(void *arg) {
+    sca_job *job = arg;
+    job->fn(job->ctx, job->lo, job->hi);
+    return NULL;
+}
+
+int sca_num_threads(int requested) {
+    if (requested > 0)
+        return requested < SCA_MAX_THREADS ? requested : SCA_MAX_THREADS;
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n < 1)
+        return 1;
+    return n < SCA_MAX_THREADS ? (int)n : SCA_MAX_THREADS;
+}
+
+void sca_parallel_ranges(int num_items, int grain, int num_threads, sca_range_fn fn, void *ctx) {
+    if (grain < 1)
+        grain = 1;
+    int num_blocks = (num_items + grain - 1) / grain;
+    int threads = sca_num_threads(num_threads);
+    if (threads > num_blocks)
+        threads = num_blocks;
+    if (threads <= 1) {
+        if (num_items > 0)
+            fn(ctx, 0, num_items);
+        return;
+    }
+
+    sca_job jobs[SCA_MAX_THREADS];
+    pthread_t tids[SCA_MAX_THREADS];
+    int started[SCA_MAX_THREADS];
+    for (int t = 0; t < threads; t++) {
+        int lo = (int)((long)num_blocks * t / threads) * grain;
+        int hi = (int)((long)num_blocks * (t + 1) / threads) * grain;
+        jobs[t] = (sca_job){fn, ctx, lo, hi < num_items ? hi : num_items};
+    }
+    // Thread 0's range runs on the caller; a range whose thread fails to start runs inline too.
+    for (int t = 1; t < threads; t++) {
+        started[t] = pthread_create(&tids[t], NULL, sca_job_run, &jobs[t]) == 0;
+        if (!started[t])
+            sca_job_run(&jobs[t]);
+    }
+    sca_job_run(&jobs[0]);
+    for (int t = 1; t < threads; t++)
+        if (started[t])
+            pthread_join(tids[t], NULL);
+}
+
+void sca_parallel_columns(int num_columns, int num_threads, sca_range_fn fn, void *ctx) {
+    sca_parallel_ranges(num_columns, SCA_BLOCK, num_threads, fn, ctx);
+}
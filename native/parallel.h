@@ -0,0 +1,24 @@
+/*
+ * Column-parallel driver shared by the native statistics.
+ *
+ * Every statistic here is independent per sample column, so the work is split into contiguous column ranges, one per
+ * thread, and each thread walks all traces over its own range. No locking: ranges never overlap.
+ */
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+// Columns per cache block - small enough that a block's accumulators stay in L1 while the traces stream past.
+#define SCA_BLOCK 256
+
+typedef void (*sca_range_fn)(void *ctx, int lo, int hi);
+
+// Threads to use for `requested`: <= 0 means one per online CPU.
+int sca_num_threads(int requested);
+
+// Calls fn(ctx, lo, hi) over [0, num_columns) split into SCA_BLOCK-aligned ranges, on up to num_threads threads.
+void sca_parallel_columns(int num_columns, int num_threads, sca_range_fn fn, void *ctx);
+
+// Same split in multiples of `grain` instead of SCA_BLOCK, for work items that are not columns (e.g. trace rows).
+void sca_parallel_ranges(int num_items, int grain, int num_threads, sca_range_fn fn, void *ctx);
+
+#endif
@@ -0,0 +1,559 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "parallel.h"
+#include "prep.h"
+#include "tracemap.h"
+
+#define PREP_CHUNK_ROWS 64      // rows per thread between two appends to the output store
+
+// Warp path steps into cell (i, j), by where they come from.
+enum { PREP_DIAG = 0, PREP_UP = 1, PREP_LEFT = 2 };    // (i - 1, j - 1), (i - 1, j), (i, j - 1)
+
+typedef struct prep_plan_struct {
+    prep_options opt;
+    const sct_map *map;
+    uint32_t num_samples;
+    uint32_t out_samples;
+    uint32_t lo;                // reference window [lo, lo + len)
+    uint32_t len;
+    float *fir;                 // taps
+    float *ref;                 // num_samples, after the low-pass
+    float *ref_win;             // len, the reference window minus its mean
+    double ref_norm;            // |ref_win|
+    double ref_mean;            // mean of the whole reference, for the elastic cost
+    float step_penalty;         // added to every non-diagonal warp step: penalty x the mean squared reference step
+    uint32_t ref_peak;          // extremum of the window, as a trace sample
+    float peak_sign;            // +1 for a maximum, -1 for a minimum
+} prep_plan;
+
+typedef struct prep_scratch_struct {
+    float *pad;                 // num_samples + taps - 1
+    float *a;
+    float *b;
+    float *corr;                // 2 * max_shift + 1
+    double *sum1;               // prefix sums over the shifted windows, len + 2 * max_shift + 1
+    double *sum2;
+    float *prev;                // DTW rows, 2 * radius + 2 (one INF past the band)
+    float *cur;
+    float *cost;
+    uint8_t *dir;               // num_samples x (2 * radius + 1)
+    double *acc;
+    int *cnt;
+} prep_scratch;
+
+typedef struct prep_job_struct {
+    const prep_plan *plan;
+    uint64_t first_row;
+    float *out;                 // rows x out_samples
+    int32_t *shifts;
+    double *scores;
+    int failed;
+} prep_job;
+
+static void prep_scratch_free(prep_scratch *s) {
+    free(s->pad);
+    free(s->a);
+    free(s->b);
+    free(s->corr);
+    free(s->sum1);
+    free(s->sum2);
+    free(s->prev);
+    free(s->cur);
+    free(s->cost);
+    free(s->dir);
+    free(s->acc);
+    free(s->cnt);
+    memset(s, 0, sizeof(*s));
+}
+
+static int prep_scratch_alloc(prep_scratch *s, const prep_plan *p) {
+    const size_t S = p->num_samples, M = (size_t)p->opt.max_shift, W = 2 * (size_t)p->opt.radius + 1;
+    memset(s, 0, sizeof(*s));
+    s->pad = malloc((S + (size_t)p->opt.taps) * sizeof(float));
+    s->a = malloc(S * sizeof(float));
+    s->b = malloc(S * sizeof(float));
+    int ok = s->pad && s->a && s->b;
+    if (p->opt.align != PREP_ALIGN_NONE) {
+        s->corr = malloc((2 * M + 1) * sizeof(float));
+        s->sum1 = malloc((p->len + 2 * M + 1) * sizeof(double));
+        s->sum2 = malloc((p->len + 2 * M + 1) * sizeof(double));
+        ok = ok && s->corr && s->sum1 && s->sum2;
+    }
+    if (p->opt.radius > 0) {
+        s->prev = malloc((W + 1) * sizeof(float));
+        s->cur = malloc((W + 1) * sizeof(float));
+        s->cost = malloc(W * sizeof(float));
+        s->dir = malloc(S * W);
+        s->acc = malloc(S * sizeof(double));
+        s->cnt = malloc(S * sizeof(int));
+        ok = ok && s->prev && s->cur && s->cost && s->dir && s->acc && s->cnt;
+    }
+    if (!ok)
+        prep_scratch_free(s);
+    return ok;
+}
+
+static void prep_decode(const sct_map *m, uint64_t row, float *x) {
+    const sct_header *h = &m->header;
+    const uint64_t at = row * h->num_samples;
+    if (h->dtype == SCT_I16) {
+        const int16_t *q = (const int16_t *)m->traces + at;
+        for (uint32_t j = 0; j < h->num_samples; j++)
+            x[j] = (float)(q[j] * h->scale + h->offset);
+    } else {
+        memcpy(x, (const float *)m->traces + at, h->num_samples * sizeof(float));
+    }
+}
+
+// Windowed-sinc low-pass with unit DC gain.
+static void prep_fir_design(float *h, int taps, double cutoff) {
+    const int half = taps / 2;
+    double sum = 0.0;
+    double *w = malloc((size_t)taps * sizeof(double));
+    if (!w)
+        return;
+    for (int k = 0; k < taps; k++) {
+        double x = k - half;
+        double sinc = x == 0.0 ? 2.0 * cutoff : sin(2.0 * M_PI * cutoff * x) / (M_PI * x);
+        double hamming = taps > 1 ? 0.54 - 0.46 * cos(2.0 * M_PI * k / (taps - 1)) : 1.0;
+        w[k] = sinc * hamming;
+        sum += w[k];
+    }
+    for (int k = 0; k < taps; k++)
+        h[k] = (float)(w[k] / sum);
+    free(w);
+}
+
+/*
+* y = x through the FIR, centered. The tap loop is outermost so the inner loop is a plain axpy over the trace, which
+* the compiler vectorizes without having to reassociate a sum.
+*/
+static void prep_lowpass(const prep_plan *p, const float *restrict x, float *restrict pad, float *restrict y) {
+    const int S = (int)p->num_samples, taps = p->opt.taps, half = taps / 2;
+    if (taps == 0) {
+        memcpy(y, x, (size_t)S * sizeof(float));
+        return;
+    }
+    for (int k = 0; k < S + taps - 1; k++) {
+        int j = k - half;
+        pad[k] = x[j < 0 ? 0 : (j >= S ? S - 1 : j)];
+    }
+    memset(y, 0, (size_t)S * sizeof(float));
+    for (int k = 0; k < taps; k++) {
+        const float h = p->fir[k];
+        const float *restrict src = pad + k;
+        for (int j = 0; j < S; j++)
+            y[j] += h * src[j];
+    }
+}
+
+// Normalized cross-correlation of the reference window with x[0, len).
+static double prep_ncc(const prep_plan *p, const float *x) {
+    double s1 = 0.0, s2 = 0.0, c = 0.0;
+    for (uint32_t i = 0; i < p->len; i++) {
+        s1 += x[i];
+        s2 += (double)x[i] * x[i];
+        c += (double)p->ref_win[i] * x[i];
+    }
+    double e = s2 - s1 * s1 / p->len;
+    return e > 0.0 && p->ref_norm > 0.0 ? c / (p->ref_norm * sqrt(e)) : 0.0;
+}
+
+/*
+* Static shift of `a` against the reference window. For the cross-correlation the shift loop is innermost: each
+* reference sample adds r * a[lo - M + i + k] to corr[k] for all 2M + 1 shifts at once, a vectorizable axpy, and the
+* window energies come from prefix sums.
+*/
+static int prep_best_shift(const prep_plan *p, prep_scratch *s, const float *restrict a, double *score) {
+    const int M = p->opt.max_shift, K = 2 * M + 1;
+    const uint32_t L = p->len;
+    const float *restrict base = a + p->lo - M;
+    int best = 0;
+    if (p->opt.align == PREP_ALIGN_PEAK) {
+        const int at = (int)p->ref_peak;
+        float top = -INFINITY;
+        for (int k = -M; k <= M; k++) {
+            float y = p->peak_sign * a[at + k];
+            if (y > top) {
+                top = y;
+                best = k;
+            }
+        }
+        *score = prep_ncc(p, a + p->lo + best);
+        return best;
+    }
+
+    float *restrict corr = s->corr;
+    for (int k = 0; k < K; k++)
+        corr[k] = 0.0f;
+    for (uint32_t i = 0; i < L; i++) {
+        const float r = p->ref_win[i];
+        const float *restrict x = base + i;
+        for (int k = 0; k < K; k++)
+            corr[k] += r * x[k];
+    }
+    s->sum1[0] = s->sum2[0] = 0.0;
+    for (uint32_t i = 0; i < L + 2 * (uint32_t)M; i++) {
+        s->sum1[i + 1] = s->sum1[i] + base[i];
+        s->sum2[i + 1] = s->sum2[i] + (double)base[i] * base[i];
+    }
+    double top = -INFINITY;
+    for (int k = 0; k < K; k++) {
+        double s1 = s->sum1[k + L] - s->sum1[k], s2 = s->sum2[k + L] - s->sum2[k];
+        double e = s2 - s1 * s1 / L;
+        double ncc = e > 0.0 && p->ref_norm > 0.0 ? corr[k] / (p->ref_norm * sqrt(e)) : 0.0;
+        if (ncc > top) {
+            top = ncc;
+            best = k - M;
+        }
+    }
+    *score = top;
+    return best;
+}
+
+static void prep_shift(const float *a, int S, int shift, float *b) {
+    for (int j = 0; j < S; j++) {
+        int at = j + shift;
+        b[j] = a[at < 0 ? 0 : (at >= S ? S - 1 : at)];
+    }
+}
+
+/*
+* Banded DTW of x against the reference, cell (i, j = i + k - R) in column k of row i. Each row is done in two
+* passes: the diagonal and up predecessors come from the previous row and vectorize; only the left predecessor is a
+* running minimum along the row. The cost compares x shifted to the reference's mean.
+*
+* Without the step penalty the warp also "explains" genuine amplitude differences: a few samples of leakage look like
+* a one-sample misalignment on a slope, so the path bends around them and the leak disappears. Charging each
+* non-diagonal step about what a one-sample misalignment costs keeps the warp to the real delays.
+*/
+static void prep_elastic(const prep_plan *p, prep_scratch *s, const float *restrict x, float *restrict out) {
+    const int S = (int)p->num_samples, R = p->opt.radius, W = 2 * R + 1;
+    double mean = 0.0;
+    for (int j = 0; j < S; j++)
+        mean += x[j];
+    const float off = (float)(mean / S - p->ref_mean);
+    const float pen = p->step_penalty;
+    float *prev = s->prev, *cur = s->cur, *restrict cost = s->cost;
+
+    for (int i = 0; i < S; i++) {
+        const int k_lo = i - R < 0 ? R - i : 0;
+        const int k_hi = i + R >= S ? S - 1 - i + R : W - 1;
+        const float r = p->ref[i] + off;
+        const float *restrict xi = x + i - R;
+        for (int k = 0; k < W; k++)
+            cost[k] = INFINITY;
+        for (int k = k_lo; k <= k_hi; k++) {
+            float d = xi[k] - r;
+            cost[k] = d * d;
+        }
+        uint8_t *restrict dir = s->dir + (size_t)i * W;
+        if (i == 0) {
+            for (int k = 0; k < W; k++) {
+                cur[k] = k < R ? INFINITY : (k == R ? cost[k] : cur[k - 1] + cost[k] + pen);
+                dir[k] = PREP_LEFT;
+            }
+        } else {
+            for (int k = 0; k < W; k++) {
+                float diag = prev[k], up = prev[k + 1] + pen;
+                cur[k] = cost[k] + (up < diag ? up : diag);
+                dir[k] = up < diag ? PREP_UP : PREP_DIAG;
+            }
+            for (int k = 1; k < W; k++) {
+                float left = cur[k - 1] + cost[k] + pen;
+                if (left < cur[k]) {
+                    cur[k] = left;
+                    dir[k] = PREP_LEFT;
+                }
+            }
+        }
+        cur[W] = INFINITY;
+        float *t = prev;
+        prev = cur;
+        cur = t;
+    }
+
+    for (int i = 0; i < S; i++) {
+        s->acc[i] = 0.0;
+        s->cnt[i] = 0;
+    }
+    // with finite samples the path stays in the band; the bounds only matter for a trace with NaNs
+    for (int i = S - 1, k = R; i >= 0 && k >= 0 && k < W;) {
+        s->acc[i] += x[i + k - R];
+        s->cnt[i]++;
+        if (i == 0 && k == R)
+            break;
+        switch (s->dir[(size_t)i * W + k]) {
+        case PREP_DIAG: i--; break;
+        case PREP_UP:   i--; k++; break;
+        default:        k--; break;
+        }
+    }
+    for (int i = 0; i < S; i++)
+        out[i] = (float)(s->acc[i] / s->cnt[i]);
+}
+
+// One trace through every stage; x is consumed as scratch.
+static void prep_row(const prep_plan *p, prep_scratch *s, float *x, float *out, int32_t *shift, double *score) {
+    const int S = (int)p->num_samples, D = p->opt.decimate;
+    float *cur = s->a, *other = s->b;
+    prep_lowpass(p, x, s->pad, cur);
+    *shift = 0;
+    *score = NAN;
+    if (p->opt.align != PREP_ALIGN_NONE) {
+        *shift = prep_best_shift(p, s, cur, score);
+        prep_shift(cur, S, *shift, other);
+        cur = s->b;
+        other = s->a;
+    }
+    if (p->opt.radius > 0) {
+        prep_elastic(p, s, cur, other);
+        cur = other;
+    }
+    if (D == 1) {
+        memcpy(out, cur, (size_t)S * sizeof(float));
+        return;
+    }
+    for (uint32_t k = 0; k < p->out_samples; k++) {
+        float sum = 0.0f;
+        for (int d = 0; d < D; d++)
+            sum += cur[(size_t)k * D + d];
+        out[k] = sum / D;
+    }
+}
+
+static void prep_range(void *ctx, int lo, int hi) {
+    prep_job *job = ctx;
+    const prep_plan *p = job->plan;
+    prep_scratch s;
+    float *x = malloc(p->num_samples * sizeof(float));
+    if (!x || !prep_scratch_alloc(&s, p)) {
+        free(x);
+        job->failed = 1;
+        return;
+    }
+    for (int r = lo; r < hi; r++) {
+        uint64_t row = job->first_row + (uint64_t)r;
+        prep_decode(p->map, row, x);
+        prep_row(p, &s, x, job->out + (size_t)r * p->out_samples, &job->shifts[row], &job->scores[row]);
+    }
+    prep_scratch_free(&s);
+    free(x);
+}
+
+// Window, norm and extremum of the reference in p->ref.
+static void prep_set_reference(prep_plan *p) {
+    double mean = 0.0, wmean = 0.0;
+    for (uint32_t j = 0; j < p->num_samples; j++)
+        mean += p->ref[j];
+    for (uint32_t i = 0; i < p->len; i++)
+        wmean += p->ref[p->lo + i];
+    p->ref_mean = mean / p->num_samples;
+    wmean /= p->len;
+    double norm = 0.0, top = -1.0;
+    for (uint32_t i = 0; i < p->len; i++) {
+        double r = p->ref[p->lo + i] - wmean;
+        p->ref_win[i] = (float)r;
+        norm += r * r;
+        if (fabs(r) > top) {
+            top = fabs(r);
+            p->ref_peak = p->lo + i;
+            p->peak_sign = r < 0.0 ? -1.0f : 1.0f;
+        }
+    }
+    p->ref_norm = sqrt(norm);
+    double step = 0.0;
+    for (uint32_t j = 1; j < p->num_samples; j++)
+        step += ((double)p->ref[j] - p->ref[j - 1]) * ((double)p->ref[j] - p->ref[j - 1]);
+    p->step_penalty = (float)(p->opt.penalty * step / (p->num_samples > 1 ? p->num_samples - 1 : 1));
+}
+
+// Mean of the first ref_traces rows after the low-pass, each aligned to the first.
+static sct_status prep_build_reference(prep_plan *p) {
+    const uint32_t S = p->num_samples;
+    prep_scratch s;
+    float *x = malloc(S * sizeof(float));
+    double *sum = calloc(S, sizeof(double));
+    if (!x || !sum || !prep_scratch_alloc(&s, p)) {
+        free(x);
+        free(sum);
+        return SCT_ERR_NOMEM;
+    }
+    prep_decode(p->map, 0, x);
+    prep_lowpass(p, x, s.pad, p->ref);
+    prep_set_reference(p);
+    for (int r = 0; r < p->opt.ref_traces; r++) {
+        prep_decode(p->map, (uint64_t)r, x);
+        prep_lowpass(p, x, s.pad, s.a);
+        const float *y = s.a;
+        if (p->opt.align != PREP_ALIGN_NONE) {
+            double score;
+            prep_shift(s.a, (int)S, prep_best_shift(p, &s, s.a, &score), s.b);
+            y = s.b;
+        }
+        for (uint32_t j = 0; j < S; j++)
+            sum[j] += y[j];
+    }
+    for (uint32_t j = 0; j < S; j++)
+        p->ref[j] = (float)(sum[j] / p->opt.ref_traces);
+    prep_set_reference(p);
+    prep_scratch_free(&s);
+    free(x);
+    free(sum);
+    return SCT_OK;
+}
+
+static sct_status prep_plan_init(prep_plan *p, const sct_map *m, const prep_options *opt) {
+    memset(p, 0, sizeof(*p));
+    p->opt = *opt;
+    p->map = m;
+    p->num_samples = m->header.num_samples;
+    const int64_t S = p->num_samples;
+    prep_options *o = &p->opt;
+    if (m->header.num_traces == 0 || S == 0)
+        return SCT_ERR_RANGE;
+    if (o->taps < 0 || (o->taps > 0 && (o->taps % 2 == 0 || !(o->cutoff > 0.0 && o->cutoff < 0.5))))
+        return SCT_ERR_RANGE;
+    if (o->align < PREP_ALIGN_NONE || o->align > PREP_ALIGN_PEAK || o->max_shift < 0 || o->radius < 0 ||
+        o->radius >= S || !(o->penalty >= 0.0) || o->decimate < 1 || o->decimate > S || o->ref_traces < 1)
+        return SCT_ERR_RANGE;
+    if (o->align == PREP_ALIGN_NONE)
+        o->max_shift = 0;
+    if ((uint64_t)o->ref_traces > m->header.num_traces)
+        o->ref_traces = (int)m->header.num_traces;
+    if (o->window_samples == 0) {
+        if (2 * (int64_t)o->max_shift >= S)
+            return SCT_ERR_RANGE;
+        p->lo = (uint32_t)o->max_shift;
+        p->len = (uint32_t)(S - 2 * o->max_shift);
+    } else {
+        p->lo = o->window_first;
+        p->len = o->window_samples;
+        if ((int64_t)p->lo < o->max_shift || (int64_t)p->lo + p->len + o->max_shift > S)
+            return SCT_ERR_RANGE;
+    }
+    p->out_samples = (uint32_t)(S / o->decimate);
+    p->fir = malloc(((size_t)o->taps + 1) * sizeof(float));
+    p->ref = malloc((size_t)S * sizeof(float));
+    p->ref_win = malloc((size_t)p->len * sizeof(float));
+    if (!p->fir || !p->ref || !p->ref_win)
+        return SCT_ERR_NOMEM;
+    if (o->taps > 0)
+        prep_fir_design(p->fir, o->taps, o->cutoff);
+    if (o->align != PREP_ALIGN_NONE || o->radius > 0)
+        return prep_build_reference(p);
+    return SCT_OK;
+}
+
+static void prep_plan_free(prep_plan *p) {
+    free(p->fir);
+    free(p->ref);
+    free(p->ref_win);
+}
+
+static int prep_same_file(const char *a, const char *b) {
+    struct stat sa, sb;
+    if (stat(a, &sa) != 0 || stat(b, &sb) != 0)
+        return 0;
+    return sa.st_dev == sb.st_dev && sa.st_ino == sb.st_ino;
+}
+
+sct_status prep_store(const char *in, const char *out, const prep_options *opt, int num_threads, int32_t *shifts,
+                      double *scores) {
+    sct_map m;
+    sct_status st = sct_map_open(&m, in);
+    if (st != SCT_OK)
+        return st;
+    prep_plan plan;
+    st = prep_plan_init(&plan, &m, opt);
+    const uint64_t N = m.header.num_traces;
+    const int threads = sca_num_threads(num_threads);
+    const size_t chunk = (size_t)PREP_CHUNK_ROWS * threads;
+    int32_t *own_shifts = NULL;
+    double *own_scores = NULL;
+    if (st == SCT_OK && !shifts)
+        shifts = own_shifts = malloc(N * sizeof(int32_t));
+    if (st == SCT_OK && !scores)
+        scores = own_scores = malloc(N * sizeof(double));
+    float *rows = st == SCT_OK ? malloc(chunk * plan.out_samples * sizeof(float)) : NULL;
+    if (st == SCT_OK && (!rows || !shifts || !scores))
+        st = SCT_ERR_NOMEM;
+
+    const int in_place = !out || !strcmp(out, in) || prep_same_file(in, out);
+    char *target = NULL;
+    if (st == SCT_OK) {
+        const char *dst = in_place ? in : out;
+        target = malloc(strlen(dst) + 5);
+        if (!target)
+            st = SCT_ERR_NOMEM;
+        else
+            sprintf(target, in_place ? "%s.tmp" : "%s", dst);
+    }
+    sct_writer w;
+    if (st == SCT_OK) {
+        const sct_header *h = &m.header;
+        int shift_only = opt->taps == 0 && opt->radius == 0 && opt->decimate == 1;
+        sct_header oh;
+        sct_header_init(&oh, shift_only ? (sct_dtype)h->dtype : SCT_F32, N, plan.out_samples, h->num_inputs,
+                        h->scale, h->offset);
+        oh.scmd = h->scmd;
+        oh.config_hash = h->config_hash;
+        st = sct_writer_open(&w, target, &oh);
+    }
+    if (st == SCT_OK) {
+        for (uint64_t r0 = 0; r0 < N && st == SCT_OK; r0 += chunk) {
+            const int n = (int)(N - r0 < chunk ? N - r0 : chunk);
+            prep_job job = {&plan, r0, rows, shifts, scores, 0};
+            sca_parallel_ranges(n, 1, threads, prep_range, &job);
+            if (job.failed)
+                st = SCT_ERR_NOMEM;
+            for (int r = 0; r < n && st == SCT_OK; r++)
+                st = sct_writer_append(&w, rows + (size_t)r * plan.out_samples);
+        }
+        if (st == SCT_OK)
+            st = sct_writer_close(&w, m.inputs, m.index);
+        else
+            sct_writer_abort(&w);
+        if (st != SCT_OK)
+            remove(target);
+    }
+    sct_map_close(&m);
+    if (st == SCT_OK && in_place && rename(target, in) != 0) {
+        remove(target);
+        st = SCT_ERR_IO;
+    }
+    free(target);
+    free(rows);
+    free(own_shifts);
+    free(own_scores);
+    prep_plan_free(&plan);
+    return st;
+}
+
+void sct_prep_store(const char **in, const char **out, const int *taps, const double *cutoff, const int *align,
+                    const int *qs, const int *qe, const int *max_shift, const int *radius, const double *penalty,
+                    const int *decimate, const int *ref_traces, const int *num_threads, int *shifts, double *scores,
+                    int *status) {
+    prep_options opt = PREP_DEFAULTS;
+    opt.taps = *taps;
+    opt.cutoff = *cutoff;
+    opt.align = *align;
+    opt.max_shift = *max_shift;
+    opt.radius = *radius;
+    opt.penalty = *penalty;
+    opt.decimate = *decimate;
+    opt.ref_traces = *ref_traces;
+    if (*qs > 0) {
+        if (*qe < *qs) {
+            *status = SCT_ERR_RANGE;
+            return;
+        }
+        opt.window_first = (uint32_t)(*qs - 1);
+        opt.window_samples = (uint32_t)(*qe - *qs + 1);
+    }
+    *status = prep_store(*in, **out ? *out : NULL, &opt, *num_threads, (int32_t *)shifts, scores);
+}
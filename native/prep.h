@@ -0,0 +1,72 @@
+/*
+ * Trace preprocessing - low-pass, alignment and decimation of a whole trace store, written back to a store.
+ *
+ * The jitter countermeasure (delay_jitter_cycles in forward_shuffled) inserts random delays, so the same operation
+ * lands on different samples in different traces and a per-sample statistic averages it away. Each trace goes through,
+ * in this order (every stage is optional):
+ *
+ *   low-pass   windowed-sinc FIR (Hamming), `taps` long, cutoff in cycles per sample; zero phase, edges extended
+ *   static     one shift per trace against a reference, over a reference window, within +-max_shift:
+ *                PREP_ALIGN_XCORR  the shift with the highest normalized cross-correlation
+ *                PREP_ALIGN_PEAK   the shift that puts the trace's extremum on the reference's (find_peaks style)
+ *              samples shifted in from past the ends repeat the edge sample
+ *   elastic    dynamic time warping against the reference within a band of +-radius samples; output sample i is the
+ *              mean of the trace samples the warp path matched to reference sample i (van Woudenberg et al., elastic
+ *              alignment). Handles delays that accumulate along the trace, which one static shift cannot. Each
+ *              non-diagonal step costs `penalty` mean squared reference steps, so the warp follows the delays and
+ *              not the leakage
+ *   decimate   mean of each `decimate` consecutive samples (also the anti-aliasing filter when there is no low-pass)
+ *
+ * The reference is the mean of the first ref_traces traces after the low-pass, each statically aligned to the first.
+ *
+ * Rows are independent, so threads split each chunk of rows; the chunk is then appended to the output store in order.
+ * Inputs, index, scmd and config hash are copied. An int16 store stays int16 when the only stage is the static shift
+ * (the samples are still ADC codes); anything else writes float32.
+ */
+#ifndef PREP_H
+#define PREP_H
+
+#include <stdint.h>
+
+#include "tracestore.h"
+
+typedef enum prep_align_enum {
+    PREP_ALIGN_NONE = 0,
+    PREP_ALIGN_XCORR = 1,
+    PREP_ALIGN_PEAK = 2,
+} prep_align;
+
+typedef struct prep_options_struct {
+    int taps;                   // low-pass length (odd), 0 for none
+    double cutoff;              // low-pass cutoff in cycles per sample, (0, 0.5)
+    int align;                  // prep_align
+    uint32_t window_first;      // reference window, 0-based; window_samples 0 = the whole trace inside +-max_shift
+    uint32_t window_samples;
+    int max_shift;
+    int radius;                 // elastic band, 0 for no elastic alignment
+    double penalty;             // cost of a non-diagonal warp step, in mean squared reference steps
+    int decimate;               // 1 for none
+    int ref_traces;
+} prep_options;
+
+#define PREP_DEFAULTS {0, 0.1, PREP_ALIGN_NONE, 0, 0, 100, 0, 4.0, 1, 32}
+
+/*
+ * Preprocess the store at `in` into `out`; out NULL or equal to in rewrites in place, through a temporary file
+ * renamed over the store, so an interrupted run leaves the original intact. shifts and scores (num_traces each, may
+ * be NULL) get each trace's static shift in samples (trace sample j + shift was moved to j) and the normalized
+ * cross-correlation with the reference at that shift. SCT_ERR_RANGE for options that do not fit the store.
+ */
+sct_status prep_store(const char *in, const char *out, const prep_options *opt, int num_threads, int32_t *shifts,
+                      double *scores);
+
+/*
+ * .C() entry point: qs/qe is the 1-based reference window (qs 0 for the default), out "" for in place. status gets an
+ * sct_status.
+ */
+void sct_prep_store(const char **in, const char **out, const int *taps, const double *cutoff, const int *align,
+                    const int *qs, const int *qe, const int *max_shift, const int *radius, const double *penalty,
+                    const int *decimate, const int *ref_traces, const int *num_threads, int *shifts, double *scores,
+                    int *status);
+
+#endif
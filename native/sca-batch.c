@@ -0,0 +1,410 @@
+/*
+ * sca-batch - run TVLA, KSLA and Yuen over a list of campaigns in one job.
+ *
+ *   sca-batch [-o out_dir] [-j jobs] [-t threads] [-m budget_mb] [-T tvla_thr] [-K ks_thr] [-Y yuen_thr]
+ *             [-g gamma] [-f min_fixed] <manifest>
+ *
+ * The manifest has one campaign per line, '#' starts a comment:
+ *
+ *   <name> <store.sct> [v] [qs] [qe]
+ *
+ * v (default 0.5) picks the fixed group, inputs[,1] == v as in the R scripts; [qs, qe] is the 1-based sample window
+ * (default: the whole trace). Campaigns must be trace stores - convert a trace_<n>.txt directory once with
+ * sct-convert.
+ *
+ * Each store is mapped once and walked a column chunk at a time: the chunk is decoded into dense fixed / random
+ * matrices and all three statistics (and the TVLA power curve) run on it while it is in memory. The chunk width is
+ * what keeps a job inside its share of -m: each of the -j campaign jobs gets budget / jobs for its two matrices, and
+ * the -t threads are divided between the jobs for the column kernels.
+ *
+ * Outputs per campaign, in the formats the R scripts and the notebook write:
+ *   tvalues2-neuron_<name>.csv          sample,t_value       (1.R tvla_from_inputs)
+ *   tvla_power_curve_<name>.csv         traces_per_group,max_abs_t
+ *   ksla_values_<name>.csv              sample,ks            (KSla.R)
+ *   yuen_tvalues_<name>_exceed<n>.csv   sample,t_value       (test_pipeline.ipynb run_yuen_pipeline)
+ * plus summary.csv with one row per campaign.
+ */
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include "ks.h"
+#include "parallel.h"
+#include "tracemap.h"
+#include "tvla.h"
+#include "yuen.h"
+
+#define BATCH_MAX_STEPS 100     // power-curve checkpoints, as in tvla_from_inputs()
+
+typedef struct batch_options_struct {
+    const char *out_dir;
+    int jobs;
+    int threads;
+    size_t budget;              // bytes for the chunk matrices of all jobs together
+    double tvla_threshold;
+    double ks_threshold;
+    double yuen_threshold;
+    double gamma;
+    int min_fixed;
+} batch_options;
+
+typedef struct campaign_struct {
+    char name[256];
+    char path[PATH_MAX];
+    double v;
+    int qs;                     // 1-based, 0 for the first sample
+    int qe;                     // 1-based, 0 for the last sample
+    // results
+    int ok;
+    int num_fixed;
+    int num_random;
+    int tvla_exceed;
+    int ks_exceed;
+    int yuen_exceed;
+    double max_abs_t;
+    double max_ks;
+    double seconds;
+} campaign;
+
+typedef struct batch_struct {
+    const batch_options *opt;
+    campaign *campaigns;
+    int num_campaigns;
+    int next;                   // next campaign to hand out, under lock
+    int kernel_threads;
+    pthread_mutex_t lock;
+} batch;
+
+static void batch_log(batch *b, const campaign *c, const char *fmt, const char *detail) {
+    pthread_mutex_lock(&b->lock);
+    fprintf(stderr, "sca-batch: %s: ", c->name);
+    fprintf(stderr, fmt, detail);
+    fputc('\n', stderr);
+    pthread_mutex_unlock(&b->lock);
+}
+
+// NaN as NA, 15 significant digits - what R's write.csv() produces.
+static void put_value(FILE *f, double x) {
+    if (isnan(x))
+        fputs("NA", f);
+    else
+        fprintf(f, "%.15g", x);
+}
+
+static int write_curve(const char *dir, const char *file, const char *column, const double *y, int n, int first) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", dir, file);
+    FILE *f = fopen(path, "w");
+    if (!f)
+        return 0;
+    fprintf(f, "\"sample\",\"%s\"\n", column);
+    for (int j = 0; j < n; j++) {
+        fprintf(f, "%d,", first + j);
+        put_value(f, y[j]);
+        fputc('\n', f);
+    }
+    return fclose(f) == 0;
+}
+
+// unique(round(seq(min_fixed, m_max, length.out = steps))), steps = min(100, m_max - min_fixed + 1)
+static int power_curve_steps(int min_fixed, int m_max, int *m) {
+    if (m_max < min_fixed)
+        return 0;
+    int steps = m_max - min_fixed + 1 < BATCH_MAX_STEPS ? m_max - min_fixed + 1 : BATCH_MAX_STEPS;
+    int k = 0;
+    for (int s = 0; s < steps; s++) {
+        double x = steps == 1 ? min_fixed : min_fixed + (double)(m_max - min_fixed) * s / (steps - 1);
+        int r = (int)nearbyint(x);     // ties to even, like R's round()
+        if (k == 0 || r != m[k - 1])
+            m[k++] = r;
+    }
+    return k;
+}
+
+/*
+* Decoded window columns [lo, lo + w) of `rows` into out (row-major, w per row).
+*/
+static void decode_rows(const sct_view *view, const int32_t *rows, int n, uint32_t lo, int w, double *out) {
+    for (int r = 0; r < n; r++)
+        sct_view_decode(view, (uint64_t)rows[r], lo, lo + (uint32_t)w, out + (size_t)r * w);
+}
+
+static int run_campaign(batch *b, campaign *c) {
+    const batch_options *opt = b->opt;
+    sct_map m;
+    sct_view view;
+    sct_status st = sct_map_open(&m, c->path);
+    if (st != SCT_OK) {
+        batch_log(b, c, "%s", sct_strerror(st));
+        return 0;
+    }
+    const int S = (int)m.header.num_samples;
+    const int qs = c->qs ? c->qs : 1, qe = c->qe ? c->qe : S;
+    if (qs < 1 || qe < qs || qe > S || sct_view_window(&view, &m, (uint32_t)(qs - 1), (uint32_t)(qe - qs + 1))) {
+        batch_log(b, c, "%s", "sample window is outside the traces");
+        sct_map_close(&m);
+        return 0;
+    }
+    const int W = qe - qs + 1, N = (int)view.num_rows;
+
+    // fixed rows first, then random, as inputs[,1] == v / != v
+    int32_t *rows = malloc((size_t)(N > 0 ? N : 1) * sizeof(int32_t));
+    int nf = 0, nr = 0;
+    for (int r = 0; rows && r < N; r++)
+        if (m.inputs[(size_t)r * m.header.num_inputs] == c->v)
+            rows[nf++] = r;
+    for (int r = 0; rows && r < N; r++)
+        if (m.inputs[(size_t)r * m.header.num_inputs] != c->v)
+            rows[nf + nr++] = r;
+    c->num_fixed = nf;
+    c->num_random = nr;
+
+    // widest chunk (whole cache blocks) whose two matrices fit this job's share of the budget
+    size_t share = opt->budget / (size_t)opt->jobs, per_column = (size_t)(N > 0 ? N : 1) * sizeof(double);
+    int chunk = (int)(share / per_column / SCA_BLOCK) * SCA_BLOCK;
+    if (chunk < SCA_BLOCK)
+        chunk = (int)(share / per_column) > 0 ? (int)(share / per_column) : 1;
+    if (chunk > W)
+        chunk = W;
+
+    int m_steps[BATCH_MAX_STEPS];
+    const int K = power_curve_steps(opt->min_fixed, nf < nr ? nf : nr, m_steps);
+    double *t = malloc((size_t)W * sizeof(double));
+    double *ks = malloc((size_t)W * sizeof(double));
+    double *yuen = malloc((size_t)W * sizeof(double));
+    double *fixed = malloc((size_t)chunk * (nf > 0 ? nf : 1) * sizeof(double));
+    double *random = malloc((size_t)chunk * (nr > 0 ? nr : 1) * sizeof(double));
+    double curve[BATCH_MAX_STEPS], chunk_curve[BATCH_MAX_STEPS];
+    int ok = rows && t && ks && yuen && fixed && random;
+    if (!ok)
+        batch_log(b, c, "%s", "out of memory (lower -m or -j)");
+    if (ok && (nf < 2 || nr < 2)) {
+        batch_log(b, c, "%s", "fewer than 2 traces in a group - check v");
+        ok = 0;
+    }
+    for (int k = 0; k < K; k++)
+        curve[k] = NAN;
+
+    for (int lo = 0; ok && lo < W; lo += chunk) {
+        int w = W - lo < chunk ? W - lo : chunk;
+        decode_rows(&view, rows, nf, (uint32_t)lo, w, fixed);
+        decode_rows(&view, rows + nf, nr, (uint32_t)lo, w, random);
+        tvla_welch(fixed, &nf, random, &nr, &w, &b->kernel_threads, t + lo);
+        ks_stat(fixed, &nf, random, &nr, &w, &b->kernel_threads, ks + lo);
+        yuen_tcurve(fixed, &nf, random, &nr, &w, &opt->gamma, &b->kernel_threads, yuen + lo, NULL);
+        if (K > 0) {
+            tvla_power_curve(fixed, &nf, random, &nr, &w, m_steps, &K, &b->kernel_threads, chunk_curve);
+            for (int k = 0; k < K; k++)
+                if (chunk_curve[k] > curve[k] || isnan(curve[k]))
+                    curve[k] = isnan(chunk_curve[k]) ? curve[k] : chunk_curve[k];
+        }
+    }
+
+    if (ok) {
+        c->max_abs_t = c->max_ks = NAN;
+        c->tvla_exceed = c->ks_exceed = c->yuen_exceed = 0;
+        for (int j = 0; j < W; j++) {
+            c->tvla_exceed += fabs(t[j]) > opt->tvla_threshold;
+            c->ks_exceed += ks[j] > opt->ks_threshold;
+            c->yuen_exceed += fabs(yuen[j]) > opt->yuen_threshold;
+            if (fabs(t[j]) > c->max_abs_t || isnan(c->max_abs_t))
+                c->max_abs_t = isnan(t[j]) ? c->max_abs_t : fabs(t[j]);
+            if (ks[j] > c->max_ks || isnan(c->max_ks))
+                c->max_ks = isnan(ks[j]) ? c->max_ks : ks[j];
+        }
+
+        char file[PATH_MAX];
+        snprintf(file, sizeof(file), "tvalues2-neuron_%s.csv", c->name);
+        ok = write_curve(opt->out_dir, file, "t_value", t, W, qs);
+        snprintf(file, sizeof(file), "ksla_values_%s.csv", c->name);
+        ok = ok && write_curve(opt->out_dir, file, "ks", ks, W, qs);
+        snprintf(file, sizeof(file), "yuen_tvalues_%s_exceed%d.csv", c->name, c->yuen_exceed);
+        ok = ok && write_curve(opt->out_dir, file, "t_value", yuen, W, qs);
+
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), "%s/tvla_power_curve_%s.csv", opt->out_dir, c->name);
+        FILE *f = ok ? fopen(path, "w") : NULL;
+        if (f) {
+            fputs("\"traces_per_group\",\"max_abs_t\"\n", f);
+            for (int k = 0; k < K; k++) {
+                fprintf(f, "%d,", m_steps[k]);
+                put_value(f, curve[k]);
+                fputc('\n', f);
+            }
+            ok = fclose(f) == 0;
+        } else {
+            ok = 0;
+        }
+        if (!ok)
+            batch_log(b, c, "cannot write results to %s", opt->out_dir);
+    }
+
+    free(rows);
+    free(t);
+    free(ks);
+    free(yuen);
+    free(fixed);
+    free(random);
+    sct_map_close(&m);
+    return ok;
+}
+
+static void *batch_worker(void *arg) {
+    batch *b = arg;
+    for (;;) {
+        pthread_mutex_lock(&b->lock);
+        int i = b->next < b->num_campaigns ? b->next++ : -1;
+        pthread_mutex_unlock(&b->lock);
+        if (i < 0)
+            return NULL;
+        campaign *c = &b->campaigns[i];
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        c->ok = run_campaign(b, c);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        c->seconds = (double)(t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) * 1e-9;
+        if (c->ok) {
+            pthread_mutex_lock(&b->lock);
+            fprintf(stderr, "sca-batch: %s: %d fixed / %d random, |t| > thr at %d, KS > thr at %d, Yuen at %d (%.1f s)\n",
+                    c->name, c->num_fixed, c->num_random, c->tvla_exceed, c->ks_exceed, c->yuen_exceed, c->seconds);
+            pthread_mutex_unlock(&b->lock);
+        }
+    }
+}
+
+static campaign *read_manifest(const char *path, int *num) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "sca-batch: %s: %s\n", path, strerror(errno));
+        exit(1);
+    }
+    campaign *list = NULL;
+    int n = 0, cap = 0, line_no = 0;
+    char line[2 * PATH_MAX];
+    while (fgets(line, sizeof(line), f)) {
+        line_no++;
+        char *hash = strchr(line, '#');
+        if (hash)
+            *hash = '\0';
+        campaign c = {.v = 0.5};
+        char name[256], store[PATH_MAX];
+        int fields = sscanf(line, "%255s %4095s %lf %d %d", name, store, &c.v, &c.qs, &c.qe);
+        if (fields <= 0)
+            continue;
+        if (fields < 2) {
+            fprintf(stderr, "sca-batch: %s:%d: expected <name> <store.sct> [v] [qs] [qe]\n", path, line_no);
+            exit(1);
+        }
+        snprintf(c.name, sizeof(c.name), "%s", name);
+        snprintf(c.path, sizeof(c.path), "%s", store);
+        if (n == cap) {
+            cap = cap ? 2 * cap : 16;
+            list = realloc(list, (size_t)cap * sizeof(campaign));
+            if (!list) {
+                fprintf(stderr, "sca-batch: out of memory\n");
+                exit(1);
+            }
+        }
+        list[n++] = c;
+    }
+    fclose(f);
+    *num = n;
+    return list;
+}
+
+static void write_summary(const batch *b) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/summary.csv", b->opt->out_dir);
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "sca-batch: %s: %s\n", path, strerror(errno));
+        return;
+    }
+    fputs("\"name\",\"store\",\"v\",\"fixed_count\",\"random_count\",\"tvla_exceed\",\"max_abs_t\",\"ksla_exceed\","
+          "\"max_ks\",\"yuen_exceed\",\"seconds\"\n", f);
+    for (int i = 0; i < b->num_campaigns; i++) {
+        const campaign *c = &b->campaigns[i];
+        if (!c->ok)
+            continue;
+        fprintf(f, "\"%s\",\"%s\",%.15g,%d,%d,%d,", c->name, c->path, c->v, c->num_fixed, c->num_random,
+                c->tvla_exceed);
+        put_value(f, c->max_abs_t);
+        fprintf(f, ",%d,", c->ks_exceed);
+        put_value(f, c->max_ks);
+        fprintf(f, ",%d,%.3f\n", c->yuen_exceed, c->seconds);
+    }
+    fclose(f);
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: sca-batch [-o out_dir] [-j jobs] [-t threads] [-m budget_mb] [-T tvla_thr] [-K ks_thr] "
+                    "[-Y yuen_thr] [-g gamma] [-f min_fixed] <manifest>\n");
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    batch_options opt = {".", 1, 0, (size_t)1024 << 20, 4.5, 0.2, 4.5, 0.2, 10};
+    int a = 1;
+    for (; a + 1 < argc && argv[a][0] == '-'; a += 2) {
+        const char *arg = argv[a + 1];
+        if (!strcmp(argv[a], "-o"))
+            opt.out_dir = arg;
+        else if (!strcmp(argv[a], "-j"))
+            opt.jobs = atoi(arg);
+        else if (!strcmp(argv[a], "-t"))
+            opt.threads = atoi(arg);
+        else if (!strcmp(argv[a], "-m"))
+            opt.budget = (size_t)atol(arg) << 20;
+        else if (!strcmp(argv[a], "-T"))
+            opt.tvla_threshold = atof(arg);
+        else if (!strcmp(argv[a], "-K"))
+            opt.ks_threshold = atof(arg);
+        else if (!strcmp(argv[a], "-Y"))
+            opt.yuen_threshold = atof(arg);
+        else if (!strcmp(argv[a], "-g"))
+            opt.gamma = atof(arg);
+        else if (!strcmp(argv[a], "-f"))
+            opt.min_fixed = atoi(arg);
+        else
+            usage();
+    }
+    if (argc - a != 1 || opt.jobs < 1 || opt.jobs > 64 || opt.budget == 0 || !(opt.gamma >= 0.0 && opt.gamma < 0.5))
+        usage();
+    if (mkdir(opt.out_dir, 0777) != 0 && errno != EEXIST) {
+        fprintf(stderr, "sca-batch: %s: %s\n", opt.out_dir, strerror(errno));
+        return 1;
+    }
+
+    batch b = {&opt, NULL, 0, 0, 1, PTHREAD_MUTEX_INITIALIZER};
+    b.campaigns = read_manifest(argv[a], &b.num_campaigns);
+    if (opt.jobs > b.num_campaigns)
+        opt.jobs = b.num_campaigns > 0 ? b.num_campaigns : 1;
+    b.kernel_threads = sca_num_threads(opt.threads) / opt.jobs;
+    if (b.kernel_threads < 1)
+        b.kernel_threads = 1;
+
+    // the main thread is worker 0
+    pthread_t tids[64];
+    int started = 0;
+    for (int j = 1; j < opt.jobs; j++)
+        if (pthread_create(&tids[started], NULL, batch_worker, &b) == 0)
+            started++;
+    batch_worker(&b);
+    for (int j = 0; j < started; j++)
+        pthread_join(tids[j], NULL);
+
+    write_summary(&b);
+    int failed = 0;
+    for (int i = 0; i < b.num_campaigns; i++)
+        failed += !b.campaigns[i].ok;
+    if (failed)
+        fprintf(stderr, "sca-batch: %d of %d campaigns failed\n", failed, b.num_campaigns);
+    free(b.campaigns);
+    return failed ? 1 : 0;
+}
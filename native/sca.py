@@ -0,0 +1,361 @@
+"""
+ctypes bindings for the native analysis engine (libsca.so, build with `make -C native`).
+
+Accumulators are plain float64 ndarrays laid out as described in tvla.h, so they can be saved,
+merged across worker processes, or extended trace by trace as a campaign is captured.
+"""
+import ctypes
+from pathlib import Path
+from typing import Optional
+
+import numpy as np
+
+_lib: Optional[ctypes.CDLL] = None
+
+_f64 = np.ctypeslib.ndpointer(dtype=np.float64, flags="C_CONTIGUOUS")
+_f32 = np.ctypeslib.ndpointer(dtype=np.float32, flags="C_CONTIGUOUS")
+_i32 = np.ctypeslib.ndpointer(dtype=np.int32, flags="C_CONTIGUOUS")
+_int = ctypes.POINTER(ctypes.c_int)
+
+
+def _c_int(x: int):
+    return ctypes.byref(ctypes.c_int(int(x)))
+
+
+def load(path: Optional[str] = None) -> Optional[ctypes.CDLL]:
+    """
+    Load libsca.so (default: next to this file). Returns None if it has not been built.
+    """
+    global _lib
+    if _lib is not None:
+        return _lib
+    lib_path = Path(path) if path else Path(__file__).resolve().parent / "libsca.so"
+    if not lib_path.exists():
+        return None
+    lib = ctypes.CDLL(str(lib_path))
+    lib.tvla_update.argtypes = [_f64, _int, _f64, _int, _i32, _int]
+    lib.tvla_update_f32.argtypes = [_f64, _int, _f32, _int, _i32, _int]
+    lib.tvla_merge.argtypes = [_f64, _f64, _int]
+    lib.tvla_tvalues.argtypes = [_f64, _int, _f64]
+    lib.tvla_welch.argtypes = [_f64, _int, _f64, _int, _int, _int, _f64]
+    lib.tvla_power_curve.argtypes = [_f64, _int, _f64, _int, _int, _i32, _int, _int, _f64]
+    lib.sct_tvla_window.argtypes = [ctypes.POINTER(ctypes.c_char_p), _int, _int,
+                                    ctypes.POINTER(ctypes.c_double), _int, _f64, _i32, _int]
+    lib.ks_stat.argtypes = [_f64, _int, _f64, _int, _int, _int, _f64]
+    lib.ks_power_curve.argtypes = [_f64, _int, _f64, _int, _int, _i32, _int, _int, _f64]
+    lib.sct_ks_window.argtypes = lib.sct_tvla_window.argtypes
+    lib.ho_update.argtypes = [_f64, _int, _int, _f64, _int, _i32, _int]
+    lib.ho_merge.argtypes = [_f64, _f64, _int, _int]
+    lib.ho_tvalues.argtypes = [_f64, _int, _int, _int, _f64]
+    lib.ho_pair_update.argtypes = [_f64, _int, _f64, _int, _i32, _int]
+    lib.ho_pair_tvalues.argtypes = [_f64, _int, _f64]
+    lib.sct_ho_window.argtypes = [ctypes.POINTER(ctypes.c_char_p), _int, _int, ctypes.POINTER(ctypes.c_double),
+                                  _int, _int, _f64, _i32, _int]
+    lib.sct_ho_pair_window.argtypes = lib.sct_tvla_window.argtypes
+    lib.yuen_tcurve.argtypes = [_f64, _int, _f64, _int, _int, ctypes.POINTER(ctypes.c_double), _int, _f64, _f64]
+    _dbl = ctypes.POINTER(ctypes.c_double)
+    lib.sct_prep_store.argtypes = [ctypes.POINTER(ctypes.c_char_p), ctypes.POINTER(ctypes.c_char_p), _int, _dbl,
+                                   _int, _int, _int, _int, _int, _dbl, _int, _int, _int, _i32, _f64, _int]
+    for fn in (lib.tvla_update, lib.tvla_update_f32, lib.tvla_merge, lib.tvla_tvalues, lib.tvla_welch,
+               lib.tvla_power_curve, lib.sct_tvla_window, lib.ks_stat, lib.ks_power_curve, lib.sct_ks_window,
+               lib.yuen_tcurve, lib.ho_update, lib.ho_merge, lib.ho_tvalues, lib.ho_pair_update,
+               lib.ho_pair_tvalues, lib.sct_ho_window, lib.sct_ho_pair_window, lib.sct_prep_store):
+        fn.restype = None
+    _lib = lib
+    return _lib
+
+
+def available() -> bool:
+    return load() is not None
+
+
+def _require() -> ctypes.CDLL:
+    lib = load()
+    if lib is None:
+        raise OSError("libsca.so not found - run `make -C native`")
+    return lib
+
+
+def _traces(X: np.ndarray, num_samples: int) -> np.ndarray:
+    X = np.atleast_2d(X)
+    if X.shape[1] != num_samples:
+        raise ValueError(f"expected {num_samples} samples per trace, got {X.shape[1]}")
+    if X.dtype != np.float32:
+        X = X.astype(np.float64, copy=False)
+    return np.ascontiguousarray(X)
+
+
+class TvlaAccumulator:
+    """
+    Running per-sample mean/variance of the fixed (group 0) and random (group 1) traces.
+    """
+
+    def __init__(self, num_samples: int, threads: int = 0):
+        self.num_samples = int(num_samples)
+        self.threads = threads
+        self.state = np.zeros(2 + 4 * self.num_samples, dtype=np.float64)
+
+    @property
+    def counts(self):
+        return int(self.state[0]), int(self.state[1])
+
+    def update(self, traces: np.ndarray, group) -> "TvlaAccumulator":
+        """
+        Add traces (N, S); group is a length-N array of 0/1 (other values are skipped) or a scalar for all rows.
+        """
+        lib = _require()
+        X = _traces(traces, self.num_samples)
+        g = np.broadcast_to(np.asarray(group, dtype=np.int32), (X.shape[0],))
+        g = np.ascontiguousarray(g)
+        fn = lib.tvla_update_f32 if X.dtype == np.float32 else lib.tvla_update
+        fn(self.state, _c_int(self.num_samples), X, _c_int(X.shape[0]), g, _c_int(self.threads))
+        return self
+
+    def merge(self, other: "TvlaAccumulator") -> "TvlaAccumulator":
+        if other.num_samples != self.num_samples:
+            raise ValueError("accumulators cover different sample counts")
+        _require().tvla_merge(self.state, other.state, _c_int(self.num_samples))
+        return self
+
+    def tvalues(self) -> np.ndarray:
+        t = np.empty(self.num_samples, dtype=np.float64)
+        _require().tvla_tvalues(self.state, _c_int(self.num_samples), t)
+        return t
+
+
+class HigherOrderAccumulator:
+    """
+    Central moments up to 2 * order per sample and group (hotvla.h), for TVLA of test orders 1 .. order.
+    """
+
+    def __init__(self, num_samples: int, order: int = 2, threads: int = 0):
+        if not 1 <= order <= 4:
+            raise ValueError("order must be in 1..4")
+        self.num_samples = int(num_samples)
+        self.order = int(order)
+        self.threads = threads
+        self.state = np.zeros(2 + 4 * self.num_samples * self.order, dtype=np.float64)
+
+    @property
+    def counts(self):
+        return int(self.state[0]), int(self.state[1])
+
+    def update(self, traces: np.ndarray, group) -> "HigherOrderAccumulator":
+        X = _traces(traces, self.num_samples).astype(np.float64, copy=False)
+        g = np.ascontiguousarray(np.broadcast_to(np.asarray(group, dtype=np.int32), (X.shape[0],)))
+        _require().ho_update(self.state, _c_int(self.num_samples), _c_int(self.order), X, _c_int(X.shape[0]), g,
+                             _c_int(self.threads))
+        return self
+
+    def merge(self, other: "HigherOrderAccumulator") -> "HigherOrderAccumulator":
+        if (other.num_samples, other.order) != (self.num_samples, self.order):
+            raise ValueError("accumulators differ in sample count or order")
+        _require().ho_merge(self.state, other.state, _c_int(self.num_samples), _c_int(self.order))
+        return self
+
+    def tvalues(self, test_order: Optional[int] = None) -> np.ndarray:
+        d = self.order if test_order is None else int(test_order)
+        if not 1 <= d <= self.order:
+            raise ValueError(f"test_order must be in 1..{self.order}")
+        t = np.empty(self.num_samples, dtype=np.float64)
+        _require().ho_tvalues(self.state, _c_int(self.num_samples), _c_int(self.order), _c_int(d), t)
+        return t
+
+
+class PairAccumulator:
+    """
+    Centered-product (bivariate second-order) TVLA over every sample pair of a W-sample window (hotvla.h).
+    """
+
+    def __init__(self, window: int, threads: int = 0):
+        self.window = int(window)
+        self.threads = threads
+        W = self.window
+        self.state = np.zeros(2 + 2 * (2 * W + 2 * W * (W + 1)), dtype=np.float64)
+
+    @property
+    def counts(self):
+        return int(self.state[0]), int(self.state[1])
+
+    def update(self, traces: np.ndarray, group) -> "PairAccumulator":
+        """
+        traces is (N, W): the window's columns only.
+        """
+        X = _traces(traces, self.window).astype(np.float64, copy=False)
+        g = np.ascontiguousarray(np.broadcast_to(np.asarray(group, dtype=np.int32), (X.shape[0],)))
+        _require().ho_pair_update(self.state, _c_int(self.window), X, _c_int(X.shape[0]), g, _c_int(self.threads))
+        return self
+
+    def tvalues(self) -> np.ndarray:
+        t = np.empty((self.window, self.window), dtype=np.float64)
+        _require().ho_pair_tvalues(self.state, _c_int(self.window), t)
+        return t
+
+
+def welch_tcurve(fixed: np.ndarray, random: np.ndarray, threads: int = 0) -> np.ndarray:
+    """
+    Per-sample Welch t of two (N, S) groups; NaN where the standard error is zero.
+    """
+    lib = _require()
+    S = np.atleast_2d(fixed).shape[1]
+    A = np.ascontiguousarray(np.atleast_2d(fixed), dtype=np.float64)
+    B = _traces(random, S).astype(np.float64, copy=False)
+    t = np.empty(S, dtype=np.float64)
+    lib.tvla_welch(A, _c_int(A.shape[0]), B, _c_int(B.shape[0]), _c_int(S), _c_int(threads), t)
+    return t
+
+
+def power_curve(fixed: np.ndarray, random: np.ndarray, m_vals, threads: int = 0) -> np.ndarray:
+    """
+    Max |t| using the first m traces of each group, for every m in the non-decreasing m_vals - in one pass over
+    the traces instead of one t-curve per m.
+    """
+    lib = _require()
+    S = np.atleast_2d(fixed).shape[1]
+    A = np.ascontiguousarray(np.atleast_2d(fixed), dtype=np.float64)
+    B = _traces(random, S).astype(np.float64, copy=False)
+    m = np.ascontiguousarray(m_vals, dtype=np.int32)
+    if m.size and (np.any(np.diff(m) < 0) or m[0] < 0 or m[-1] > min(A.shape[0], B.shape[0])):
+        raise ValueError("m_vals must be non-decreasing and within both groups")
+    out = np.empty(m.size, dtype=np.float64)
+    lib.tvla_power_curve(A, _c_int(A.shape[0]), B, _c_int(B.shape[0]), _c_int(S), m, _c_int(m.size),
+                         _c_int(threads), out)
+    return out
+
+
+def ks_dcurve(fixed: np.ndarray, random: np.ndarray, threads: int = 0) -> np.ndarray:
+    """
+    Per-sample two-sample KS D of two (N, S) groups, tie-aware like scipy's ks_2samp; NaN where a group is empty.
+    """
+    lib = _require()
+    S = np.atleast_2d(fixed).shape[1]
+    A = np.ascontiguousarray(np.atleast_2d(fixed), dtype=np.float64)
+    B = _traces(random, S).astype(np.float64, copy=False)
+    D = np.empty(S, dtype=np.float64)
+    lib.ks_stat(A, _c_int(A.shape[0]), B, _c_int(B.shape[0]), _c_int(S), _c_int(threads), D)
+    return D
+
+
+def ks_power_curve(fixed: np.ndarray, random: np.ndarray, m_vals, threads: int = 0) -> np.ndarray:
+    """
+    (len(m_vals), S) per-sample D using the first m traces of each group, for every m in the non-decreasing
+    m_vals; the counts are extended between checkpoints instead of recomputing D for each m.
+    """
+    lib = _require()
+    S = np.atleast_2d(fixed).shape[1]
+    A = np.ascontiguousarray(np.atleast_2d(fixed), dtype=np.float64)
+    B = _traces(random, S).astype(np.float64, copy=False)
+    m = np.ascontiguousarray(m_vals, dtype=np.int32)
+    if m.size and (np.any(np.diff(m) < 0) or m[0] < 0 or m[-1] > min(A.shape[0], B.shape[0])):
+        raise ValueError("m_vals must be non-decreasing and within both groups")
+    D = np.empty((m.size, S), dtype=np.float64)
+    if m.size:
+        lib.ks_power_curve(A, _c_int(A.shape[0]), B, _c_int(B.shape[0]), _c_int(S), m, _c_int(m.size),
+                           _c_int(threads), D)
+    return D
+
+
+def yuen_tcurve(fixed: np.ndarray, random: np.ndarray, gamma: float = 0.2, threads: int = 0):
+    """
+    Per-sample Yuen trimmed-mean t and its df for two (N, S) groups; NaN where a group keeps fewer than 2 values,
+    holds NaN, or the standard error is zero. Returns (t, df).
+    """
+    if not 0 <= gamma < 0.5:
+        raise ValueError("gamma must be in [0, 0.5)")
+    lib = _require()
+    S = np.atleast_2d(fixed).shape[1]
+    A = np.ascontiguousarray(np.atleast_2d(fixed), dtype=np.float64)
+    B = _traces(random, S).astype(np.float64, copy=False)
+    t = np.empty(S, dtype=np.float64)
+    df = np.empty(S, dtype=np.float64)
+    lib.yuen_tcurve(A, _c_int(A.shape[0]), B, _c_int(B.shape[0]), _c_int(S), ctypes.byref(ctypes.c_double(gamma)),
+                    _c_int(threads), t, df)
+    return t, df
+
+
+_SCT_ERRORS = {1: "I/O error", 2: "not a supported trace store", 3: "out of memory", 4: "value out of range"}
+
+
+def _store_window(fn, path, v: float, qs: int, qe: Optional[int], threads: int, rows: int = 1, args=()):
+    """
+    Calls a sct_*_window entry point; its output is rows x W (rows=0: W x W), args go between v and threads.
+    """
+    if qe is None:
+        from tracestore import TraceStore
+        qe = TraceStore(path).num_samples
+    W = max(0, qe - qs + 1)
+    out = np.empty((rows or W, W) if rows != 1 else W, dtype=np.float64)
+    counts = np.zeros(2, dtype=np.int32)
+    status = ctypes.c_int(0)
+    c_path = ctypes.c_char_p(str(path).encode())
+    fn(ctypes.byref(c_path), _c_int(qs), _c_int(qe), ctypes.byref(ctypes.c_double(v)), *args, _c_int(threads), out,
+       counts, ctypes.byref(status))
+    if status.value:
+        raise OSError(f"{path}: {_SCT_ERRORS.get(status.value, 'error')}")
+    return out, (int(counts[0]), int(counts[1]))
+
+
+def store_tcurve(path, v: float, qs: int = 1, qe: Optional[int] = None, threads: int = 0):
+    """
+    Welch t-curve of window [qs:qe] (1-based inclusive, default: whole trace) of a trace store, fixed = first
+    input == v, streamed from the mapped file. Returns (t, (n_fixed, n_random)).
+    """
+    return _store_window(_require().sct_tvla_window, path, v, qs, qe, threads)
+
+
+def store_ho_tcurves(path, v: float, order: int = 2, qs: int = 1, qe: Optional[int] = None, threads: int = 0):
+    """
+    t-curves of test orders 1 .. order over a trace store window, grouped as store_tcurve(), in one pass over the
+    mapped file. Returns ((order, W) array, row d - 1 = order d, (n_fixed, n_random)).
+    """
+    if not 1 <= order <= 4:
+        raise ValueError("order must be in 1..4")
+    t, counts = _store_window(_require().sct_ho_window, path, v, qs, qe, threads, rows=order,
+                              args=(_c_int(order),))
+    return t.reshape(order, -1), counts
+
+
+def store_pair_tmatrix(path, v: float, qs: int, qe: int, threads: int = 0):
+    """
+    (W, W) centered-product t of every sample pair in store window [qs:qe]. Returns (t, (n_fixed, n_random)).
+    """
+    return _store_window(_require().sct_ho_pair_window, path, v, qs, qe, threads, rows=0)
+
+
+def store_ks_dcurve(path, v: float, qs: int = 1, qe: Optional[int] = None, threads: int = 0):
+    """
+    KS D-curve of a trace store window, grouped as store_tcurve(). Returns (D, (n_fixed, n_random)).
+    """
+    return _store_window(_require().sct_ks_window, path, v, qs, qe, threads)
+
+
+_PREP_ALIGN = {None: 0, "none": 0, "xcorr": 1, "peak": 2}
+
+
+def preprocess_store(path, out=None, lowpass=None, align=None, window=None, max_shift: int = 100, radius: int = 0,
+                     penalty: float = 4.0, decimate: int = 1, ref_traces: int = 32, threads: int = 0):
+    """
+    Low-pass, align and decimate a trace store (native/prep.h), in place unless out is given.
+    lowpass is (taps, cutoff in cycles per sample); align "xcorr" or "peak" matches the 1-based window (qs, qe)
+    within +-max_shift; radius > 0 adds elastic (DTW) alignment for jitter. Returns (shifts, correlations), one per
+    trace.
+    """
+    if align not in _PREP_ALIGN:
+        raise ValueError("align must be None, 'xcorr' or 'peak'")
+    lib = _require()
+    from tracestore import TraceStore
+    N = TraceStore(path).num_traces
+    taps, cutoff = lowpass if lowpass else (0, 0.1)
+    qs, qe = window if window else (0, 0)
+    shifts = np.zeros(N, dtype=np.int32)
+    scores = np.zeros(N, dtype=np.float64)
+    status = ctypes.c_int(0)
+    c_in = ctypes.c_char_p(str(path).encode())
+    c_out = ctypes.c_char_p(str(out).encode() if out else b"")
+    lib.sct_prep_store(ctypes.byref(c_in), ctypes.byref(c_out), _c_int(taps), ctypes.byref(ctypes.c_double(cutoff)),
+                       _c_int(_PREP_ALIGN[align]), _c_int(qs), _c_int(qe), _c_int(max_shift), _c_int(radius),
+                       ctypes.byref(ctypes.c_double(penalty)), _c_int(decimate), _c_int(ref_traces), _c_int(threads),
+                       shifts, scores, ctypes.byref(status))
+    if status.value:
+        raise OSError(f"{path}: {_SCT_ERRORS.get(status.value, 'error')}")
+    return shifts, scores
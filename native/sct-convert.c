@@ -0,0 +1,277 @@
+/*
+ * sct-convert - pack a capture directory (trace_<n>.txt + inputs.txt) into one trace store.
+ *
+ *   sct-convert [-d auto|f32|i16] [-s scmd] [-c network_config.h] [-i inputs.txt] <trace_dir> <out.sct>
+ *
+ * Rows are written in trace index order and the inputs are aligned to them (inputs row n belongs to trace_<n>.txt),
+ * so readers no longer need the sort-and-+1 step. -d auto (the default) stores int16 ADC codes when the traces are
+ * ChipWhisperer code / 1024 - 0.5 values and float32 otherwise.
+ */
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tracestore.h"
+
+#define CW_ADC_SCALE (1.0 / 1024.0)
+#define CW_ADC_OFFSET (-0.5)
+
+typedef struct trace_file_struct {
+    int32_t index;
+    char *path;
+} trace_file;
+
+typedef struct doubles_struct {
+    double *v;
+    size_t n;
+    size_t cap;
+} doubles;
+
+static void die(const char *what, const char *detail) {
+    fprintf(stderr, "sct-convert: %s%s%s\n", what, detail ? ": " : "", detail ? detail : "");
+    exit(1);
+}
+
+static void push(doubles *d, double x) {
+    if (d->n == d->cap) {
+        d->cap = d->cap ? 2 * d->cap : 4096;
+        d->v = realloc(d->v, d->cap * sizeof(double));
+        if (!d->v)
+            die("out of memory", NULL);
+    }
+    d->v[d->n++] = x;
+}
+
+static char *read_file(const char *path, size_t *len) {
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        die(strerror(errno), path);
+    fseeko(f, 0, SEEK_END);
+    off_t size = ftello(f);
+    fseeko(f, 0, SEEK_SET);
+    char *buf = malloc((size_t)size + 1);
+    if (!buf)
+        die("out of memory", NULL);
+    if (fread(buf, 1, (size_t)size, f) != (size_t)size)
+        die(strerror(errno), path);
+    fclose(f);
+    buf[size] = '\0';
+    *len = (size_t)size;
+    return buf;
+}
+
+// Every number in the file, in order. `per_line` (optional) gets the count on the first non-empty line.
+static void parse_numbers(const char *path, doubles *out, size_t *per_line) {
+    size_t len;
+    char *buf = read_file(path, &len);
+    char *p = buf;
+    out->n = 0;
+    int first_line_done = 0;
+    while (*p) {
+        while (*p && isspace((unsigned char)*p)) {
+            if (*p == '\n' && out->n > 0 && !first_line_done) {
+                first_line_done = 1;
+                if (per_line)
+                    *per_line = out->n;
+            }
+            p++;
+        }
+        if (!*p)
+            break;
+        char *end;
+        double x = strtod(p, &end);
+        if (end == p)
+            die("not a number in", path);
+        push(out, x);
+        p = end;
+    }
+    if (per_line && !first_line_done)
+        *per_line = out->n;
+    free(buf);
+}
+
+static int by_index(const void *a, const void *b) {
+    int32_t x = ((const trace_file *)a)->index, y = ((const trace_file *)b)->index;
+    return (x > y) - (x < y);
+}
+
+static trace_file *list_traces(const char *dir, size_t *count) {
+    DIR *d = opendir(dir);
+    if (!d)
+        die(strerror(errno), dir);
+    trace_file *files = NULL;
+    size_t n = 0, cap = 0;
+    struct dirent *e;
+    while ((e = readdir(d))) {
+        char tail[8];
+        long idx;
+        if (sscanf(e->d_name, "trace_%ld%7s", &idx, tail) != 2 || strcmp(tail, ".txt") != 0 || idx < 0)
+            continue;
+        if (n == cap) {
+            cap = cap ? 2 * cap : 1024;
+            files = realloc(files, cap * sizeof(*files));
+            if (!files)
+                die("out of memory", NULL);
+        }
+        size_t plen = strlen(dir) + strlen(e->d_name) + 2;
+        files[n].index = (int32_t)idx;
+        files[n].path = malloc(plen);
+        if (!files[n].path)
+            die("out of memory", NULL);
+        snprintf(files[n].path, plen, "%s/%s", dir, e->d_name);
+        n++;
+    }
+    closedir(d);
+    if (n == 0)
+        die("no trace_*.txt files under", dir);
+    qsort(files, n, sizeof(*files), by_index);
+    *count = n;
+    return files;
+}
+
+// One pass over the traces into `out`. With `exact`, an i16 store stops with SCT_ERR_RANGE at the first trace that
+// would not round-trip.
+static sct_status write_store(const char *out, sct_header *h, const trace_file *files, const double *inputs,
+                              const int32_t *index, int exact) {
+    sct_writer w;
+    sct_status st = sct_writer_open(&w, out, h);
+    if (st != SCT_OK)
+        return st;
+    doubles trace = {0};
+    float *row = malloc((size_t)h->num_samples * sizeof(float));
+    if (!row)
+        die("out of memory", NULL);
+    for (uint64_t r = 0; r < h->num_traces && st == SCT_OK; r++) {
+        parse_numbers(files[r].path, &trace, NULL);
+        if (trace.n != h->num_samples) {
+            fprintf(stderr, "sct-convert: %s has %zu samples, expected %u\n", files[r].path, trace.n,
+                    h->num_samples);
+            exit(1);
+        }
+        for (uint32_t j = 0; j < h->num_samples; j++)
+            row[j] = (float)trace.v[j];
+        if (exact && h->dtype == SCT_I16 && !sct_fits_i16(row, h->num_samples, h->scale, h->offset))
+            st = SCT_ERR_RANGE;
+        else
+            st = sct_writer_append(&w, row);
+    }
+    free(row);
+    free(trace.v);
+    if (st != SCT_OK) {
+        sct_writer_abort(&w);
+        return st;
+    }
+    return sct_writer_close(&w, inputs, index);
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: sct-convert [-d auto|f32|i16] [-s scmd] [-c network_config.h] [-i inputs.txt] "
+                    "<trace_dir> <out.sct>\n");
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    const char *dtype = "auto", *config = NULL, *inputs_path = NULL;
+    int scmd = SCT_SCMD_UNKNOWN;
+    int a = 1;
+    for (; a + 1 < argc && argv[a][0] == '-'; a += 2) {
+        if (!strcmp(argv[a], "-d"))
+            dtype = argv[a + 1];
+        else if (!strcmp(argv[a], "-s"))
+            scmd = atoi(argv[a + 1]);
+        else if (!strcmp(argv[a], "-c"))
+            config = argv[a + 1];
+        else if (!strcmp(argv[a], "-i"))
+            inputs_path = argv[a + 1];
+        else
+            usage();
+    }
+    if (argc - a != 2 || (strcmp(dtype, "auto") && strcmp(dtype, "f32") && strcmp(dtype, "i16")))
+        usage();
+    const char *dir = argv[a], *out = argv[a + 1];
+
+    size_t num_traces;
+    trace_file *files = list_traces(dir, &num_traces);
+
+    doubles first = {0};
+    parse_numbers(files[0].path, &first, NULL);
+    if (first.n == 0)
+        die("empty trace", files[0].path);
+
+    char default_inputs[4096];
+    if (!inputs_path) {
+        snprintf(default_inputs, sizeof(default_inputs), "%s/inputs.txt", dir);
+        inputs_path = default_inputs;
+    }
+    doubles all_inputs = {0};
+    size_t num_inputs = 0;
+    parse_numbers(inputs_path, &all_inputs, &num_inputs);
+    if (num_inputs == 0 || all_inputs.n % num_inputs != 0)
+        die("inputs file is not a rectangular matrix", inputs_path);
+    size_t input_rows = all_inputs.n / num_inputs;
+
+    // inputs row n belongs to trace_<n>.txt
+    double *inputs = malloc(num_traces * num_inputs * sizeof(double));
+    int32_t *index = malloc(num_traces * sizeof(int32_t));
+    if (!inputs || !index)
+        die("out of memory", NULL);
+    for (size_t r = 0; r < num_traces; r++) {
+        if ((size_t)files[r].index >= input_rows) {
+            fprintf(stderr, "sct-convert: %s has %zu rows, but trace_%d.txt exists\n", inputs_path, input_rows,
+                    files[r].index);
+            return 1;
+        }
+        memcpy(inputs + r * num_inputs, all_inputs.v + (size_t)files[r].index * num_inputs,
+               num_inputs * sizeof(double));
+        index[r] = files[r].index;
+    }
+
+    uint64_t config_hash = 0;
+    if (config) {
+        size_t len;
+        char *text = read_file(config, &len);
+        config_hash = sct_hash(SCT_HASH_INIT, text, len);
+        free(text);
+    }
+
+    float *probe = malloc(first.n * sizeof(float));
+    if (!probe)
+        die("out of memory", NULL);
+    for (size_t j = 0; j < first.n; j++)
+        probe[j] = (float)first.v[j];
+    int i16 = !strcmp(dtype, "i16") ||
+              (!strcmp(dtype, "auto") && sct_fits_i16(probe, (uint32_t)first.n, CW_ADC_SCALE, CW_ADC_OFFSET));
+    free(probe);
+
+    sct_header h;
+    sct_header_init(&h, i16 ? SCT_I16 : SCT_F32, num_traces, (uint32_t)first.n, (uint32_t)num_inputs,
+                    CW_ADC_SCALE, CW_ADC_OFFSET);
+    h.scmd = scmd;
+    h.config_hash = config_hash;
+    int automatic = !strcmp(dtype, "auto");
+    sct_status st = write_store(out, &h, files, inputs, index, automatic);
+    if (st == SCT_ERR_RANGE && automatic && h.dtype == SCT_I16) {
+        // a later trace is not plain ADC codes - redo the whole campaign as float32
+        sct_header_init(&h, SCT_F32, num_traces, (uint32_t)first.n, (uint32_t)num_inputs, 1.0, 0.0);
+        h.scmd = scmd;
+        h.config_hash = config_hash;
+        st = write_store(out, &h, files, inputs, index, 0);
+    }
+    if (st != SCT_OK) {
+        remove(out);
+        die(sct_strerror(st), out);
+    }
+    printf("%s: %zu traces x %u samples, %s, %zu inputs per trace\n", out, num_traces, h.num_samples,
+           h.dtype == SCT_I16 ? "int16" : "float32", num_inputs);
+
+    for (size_t r = 0; r < num_traces; r++)
+        free(files[r].path);
+    free(files);
+    free(first.v);
+    free(all_inputs.v);
+    free(inputs);
+    free(index);
+    return 0;
+}
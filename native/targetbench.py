@@ -0,0 +1,111 @@
+"""
+Cycle counts measured on the target - the 'b' command of the network firmware (network/bench.h), in the CSV layout
+`make host-bench` prints, so target and host numbers go through the same scripts. Needs only the standard library.
+
+    rows = sweep(target, config="default", iterations=1000)
+    write_csv("bench-target.csv", rows)
+
+The target counts DWT CYCCNT cycles. It does not compute the output error, so max_abs_err is left empty; that column
+comes from bench-host.
+"""
+import csv
+import struct
+from pathlib import Path
+from typing import Dict, List, Sequence, Union
+
+# bench_result: seven little-endian uint32 in field order
+RESULT_FIELDS = ("scmd", "iterations", "macs", "setup_cycles", "forward_cycles", "nojitter_cycles", "refill_cycles")
+RESULT_FORMAT = "<7I"
+RESULT_LEN = struct.calcsize(RESULT_FORMAT)
+
+# mac_kernel in network.h, named as mac_kernel_name() does
+KERNELS = ("reference", "fma_unrolled", "q15_smlad", "simd")
+NET_NUM_SCMD = 13
+DEFERRED_SCMDS = (0, 1, 2, 3, 4, 5, 10, 12)
+FLOAT_SCMDS = (0, 1, 2, 3, 4, 5, 10, 11, 12)
+SHUFFLED_SCMDS = (1, 4, 5, 7, 9, 10)
+
+COLUMNS = ("config", "scmd", "kernel", "iterations", "macs", "cycles_per_inference", "cycles_per_mac",
+           "speedup_vs_reference", "max_abs_err", "shuffle_setup_cycles", "jitter_cycles", "pool_refill_cycles")
+
+PathLike = Union[str, Path]
+
+
+def parse_result(payload) -> Dict[str, int]:
+    """One 'b' response as a dict of the bench_result fields."""
+    raw = bytes(payload)
+    if len(raw) != RESULT_LEN:
+        raise ValueError(f"expected {RESULT_LEN} bytes, got {len(raw)}")
+    return dict(zip(RESULT_FIELDS, struct.unpack(RESULT_FORMAT, raw)))
+
+
+def row(config: str, kernel: str, result: Dict[str, int], reference_cycles: int) -> Dict[str, object]:
+    """A bench-host CSV row from a parsed result; jitter_cycles is clamped at 0 as in print_row()."""
+    fwd, macs = result["forward_cycles"], result["macs"]
+    return {
+        "config": config,
+        "scmd": result["scmd"],
+        "kernel": kernel,
+        "iterations": result["iterations"],
+        "macs": macs,
+        "cycles_per_inference": fwd,
+        "cycles_per_mac": f"{fwd / macs:.2f}" if macs else "0.00",
+        "speedup_vs_reference": f"{reference_cycles / fwd:.2f}" if fwd else "0.00",
+        "max_abs_err": "",
+        "shuffle_setup_cycles": result["setup_cycles"],
+        "jitter_cycles": max(fwd - result["nojitter_cycles"], 0),
+        "pool_refill_cycles": result["refill_cycles"],
+    }
+
+
+def _switch(target, cmd: str, value: int) -> None:
+    # 'k', 'a', 'g' and 'm' take their setting in scmd and answer with one byte
+    target.send_cmd(cmd, value, bytearray())
+    target.simpleserial_read("r", 1)
+    target.read_cmd("e")
+
+
+def bench(target, scmd: int, iterations: int, timeout: int = 60000) -> Dict[str, int]:
+    """Runs bench_scmd() for one mode on the target. The reply comes after all iterations, hence the long timeout."""
+    target.send_cmd("b", scmd, bytearray(struct.pack("<I", iterations)))
+    result = parse_result(target.simpleserial_read("r", RESULT_LEN, timeout=timeout))
+    target.read_cmd("e")
+    return result
+
+
+def sweep(target, config: str, iterations: int, num_scmd: int = NET_NUM_SCMD,
+          kernels: Sequence[str] = KERNELS, timeout: int = 60000) -> List[Dict[str, object]]:
+    """
+    The rows of `make host-bench` in the same order: scmd 0 per MAC kernel, every other mode, then the deferred
+    activation ('a'), fast sigmoid ('g') and masked shuffle ('m') rows. Leaves the target on the reference kernel with
+    the switches off.
+    """
+    rows = []
+    reference_cycles = 0
+    for k, name in enumerate(kernels):
+        _switch(target, "k", k)
+        r = bench(target, 0, iterations, timeout)
+        if k == 0:
+            reference_cycles = r["forward_cycles"]
+        rows.append(row(config, name, r, reference_cycles))
+    _switch(target, "k", 0)
+    for scmd in range(1, num_scmd):
+        rows.append(row(config, kernels[0], bench(target, scmd, iterations, timeout), reference_cycles))
+
+    for cmd, name, scmds in (("a", "deferred_act", DEFERRED_SCMDS), ("g", "fast_sigmoid", FLOAT_SCMDS),
+                             ("m", "masked_shuffle", SHUFFLED_SCMDS)):
+        _switch(target, cmd, 1)
+        for scmd in scmds:
+            rows.append(row(config, name, bench(target, scmd, iterations, timeout), reference_cycles))
+        _switch(target, cmd, 0)
+    return rows
+
+
+def write_csv(path: PathLike, rows: Sequence[Dict[str, object]], header: bool = True) -> Path:
+    path = Path(path)
+    with open(path, "w" if header else "a", newline="") as f:
+        w = csv.DictWriter(f, fieldnames=COLUMNS)
+        if header:
+            w.writeheader()
+        w.writerows(rows)
+    return path
@@ -0,0 +1,121 @@
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "tracemap.h"
+
+sct_status sct_map_open(sct_map *m, const char *path) {
+    memset(m, 0, sizeof(*m));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return SCT_ERR_IO;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return SCT_ERR_IO;
+    }
+    if ((uint64_t)st.st_size < sizeof(sct_header)) {
+        close(fd);
+        return SCT_ERR_FORMAT;
+    }
+    void *base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+        return SCT_ERR_IO;
+
+    const sct_header *h = base;
+    m->base = base;
+    m->length = (size_t)st.st_size;
+    m->header = *h;
+    sct_status status = SCT_OK;
+    if (memcmp(h->magic, SCT_MAGIC, sizeof(h->magic)) != 0 || h->version != SCT_VERSION ||
+        (h->dtype != SCT_F32 && h->dtype != SCT_I16))
+        status = SCT_ERR_FORMAT;
+    else if (h->traces_offset + h->num_traces * h->num_samples * sct_sample_size((sct_dtype)h->dtype) >
+                 h->inputs_offset ||
+             h->index_offset + h->num_traces * sizeof(int32_t) > m->length)
+        status = SCT_ERR_FORMAT;    // truncated, or offsets that overlap
+    if (status != SCT_OK) {
+        sct_map_close(m);
+        return status;
+    }
+    m->traces = m->base + h->traces_offset;
+    m->inputs = (const double *)(m->base + h->inputs_offset);
+    m->index = (const int32_t *)(m->base + h->index_offset);
+    return SCT_OK;
+}
+
+void sct_map_close(sct_map *m) {
+    if (m->base)
+        munmap((void *)m->base, m->length);
+    memset(m, 0, sizeof(*m));
+}
+
+sct_status sct_view_window(sct_view *v, const sct_map *m, uint32_t first, uint32_t n) {
+    if ((uint64_t)first + n > m->header.num_samples)
+        return SCT_ERR_RANGE;
+    *v = (sct_view){m, NULL, m->header.num_traces, first, n};
+    return SCT_OK;
+}
+
+sct_status sct_view_rows(sct_view *v, const int32_t *rows, uint64_t num_rows) {
+    for (uint64_t i = 0; i < num_rows; i++)
+        if (rows[i] < 0 || (uint64_t)rows[i] >= v->map->header.num_traces)
+            return SCT_ERR_RANGE;
+    v->rows = rows;
+    v->num_rows = num_rows;
+    return SCT_OK;
+}
+
+void sct_view_decode(const sct_view *v, uint64_t i, uint32_t lo, uint32_t hi, double *out) {
+    const sct_header *h = &v->map->header;
+    if (h->dtype == SCT_I16) {
+        const int16_t *x = (const int16_t *)sct_view_data(v, i) + lo;
+        for (uint32_t j = 0; j < hi - lo; j++)
+            out[j] = x[j] * h->scale + h->offset;
+    } else {
+        const float *x = (const float *)sct_view_data(v, i) + lo;
+        for (uint32_t j = 0; j < hi - lo; j++)
+            out[j] = x[j];
+    }
+}
+
+void sct_read_window(const char **path, const int *rows, const int *num_rows, const int *qs, const int *qe,
+                     double *out, int *status) {
+    sct_map m;
+    sct_view v;
+    *status = sct_map_open(&m, *path);
+    if (*status != SCT_OK)
+        return;
+    int32_t *rows0 = NULL;
+    if (*qs < 1 || *qe < *qs)
+        *status = SCT_ERR_RANGE;
+    else
+        *status = sct_view_window(&v, &m, (uint32_t)(*qs - 1), (uint32_t)(*qe - *qs + 1));
+    if (*status == SCT_OK && *num_rows > 0) {
+        rows0 = malloc((size_t)*num_rows * sizeof(int32_t));
+        if (!rows0)
+            *status = SCT_ERR_NOMEM;
+        for (int i = 0; rows0 && i < *num_rows; i++)
+            rows0[i] = rows[i] - 1;
+        if (rows0)
+            *status = sct_view_rows(&v, rows0, (uint64_t)*num_rows);
+    }
+    if (*status == SCT_OK) {
+        double *row = malloc((size_t)v.num_samples * sizeof(double));
+        if (!row)
+            *status = SCT_ERR_NOMEM;
+        // R matrices are column-major: element (i, j) lands at out[i + j * num_rows]
+        for (uint64_t i = 0; row && i < v.num_rows; i++) {
+            sct_view_decode(&v, i, 0, v.num_samples, row);
+            for (uint32_t j = 0; j < v.num_samples; j++)
+                out[i + (uint64_t)j * v.num_rows] = row[j];
+        }
+        free(row);
+    }
+    free(rows0);
+    sct_map_close(&m);
+}
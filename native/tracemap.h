@@ -0,0 +1,61 @@
+/*
+ * Memory-mapped trace store with zero-copy views.
+ *
+ * sct_map_open() maps a whole store read-only; nothing is read until a page is touched, so a campaign larger than RAM
+ * costs only the pages a statistic actually walks. An sct_view picks a sample window and optionally a row subset
+ * (e.g. the fixed group) without copying - statistics take the view and decode a column block at a time.
+ */
+#ifndef TRACEMAP_H
+#define TRACEMAP_H
+
+#include <stdint.h>
+
+#include "tracestore.h"
+
+typedef struct sct_map_struct {
+    sct_header header;
+    const uint8_t *base;
+    size_t length;
+    const void *traces;         // header.dtype samples, num_traces x num_samples
+    const double *inputs;       // num_traces x num_inputs
+    const int32_t *index;
+} sct_map;
+
+typedef struct sct_view_struct {
+    const sct_map *map;
+    const int32_t *rows;        // store rows of the view, NULL for all of them in order
+    uint64_t num_rows;
+    uint32_t first_sample;      // 0-based start of the window in the store
+    uint32_t num_samples;
+} sct_view;
+
+sct_status sct_map_open(sct_map *m, const char *path);
+void sct_map_close(sct_map *m);
+
+// Samples [first, first + n) of every row; SCT_ERR_RANGE if that runs past the traces.
+sct_status sct_view_window(sct_view *v, const sct_map *m, uint32_t first, uint32_t n);
+// Restrict a view to `rows` (store row numbers, not view rows; the array must outlive the view).
+sct_status sct_view_rows(sct_view *v, const int32_t *rows, uint64_t num_rows);
+
+static inline uint64_t sct_view_row(const sct_view *v, uint64_t i) {
+    return v->rows ? (uint64_t)v->rows[i] : i;
+}
+
+// Raw (undecoded) pointer to view row i at window column 0.
+static inline const void *sct_view_data(const sct_view *v, uint64_t i) {
+    const sct_header *h = &v->map->header;
+    uint64_t at = sct_view_row(v, i) * h->num_samples + v->first_sample;
+    return (const uint8_t *)v->map->traces + at * sct_sample_size((sct_dtype)h->dtype);
+}
+
+// Decoded view[i, lo:hi) into out[0 .. hi - lo).
+void sct_view_decode(const sct_view *v, uint64_t i, uint32_t lo, uint32_t hi, double *out);
+
+/*
+ * .C() entry point for R: window [qs, qe] (1-based, inclusive) of the store rows `rows` (1-based, as R indexes;
+ * num_rows 0 for all rows) into `out` as a column-major num_rows x (qe - qs + 1) matrix. status gets an sct_status.
+ */
+void sct_read_window(const char **path, const int *rows, const int *num_rows, const int *qs, const int *qe,
+                     double *out, int *status);
+
+#endif
@@ -0,0 +1,161 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tracestore.h"
+
+const char *sct_strerror(sct_status status) {
+    switch (status) {
+    case SCT_OK:         return "ok";
+    case SCT_ERR_IO:     return "I/O error";
+    case SCT_ERR_FORMAT: return "not a supported trace store";
+    case SCT_ERR_NOMEM:  return "out of memory";
+    case SCT_ERR_RANGE:  return "value out of range";
+    }
+    return "unknown error";
+}
+
+uint64_t sct_hash(uint64_t h, const void *data, size_t len) {
+    const uint8_t *p = data;
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+size_t sct_sample_size(sct_dtype dtype) {
+    return dtype == SCT_I16 ? sizeof(int16_t) : sizeof(float);
+}
+
+static uint64_t sct_align(uint64_t x) {
+    return (x + SCT_ALIGN - 1) / SCT_ALIGN * SCT_ALIGN;
+}
+
+void sct_header_init(sct_header *h, sct_dtype dtype, uint64_t num_traces, uint32_t num_samples, uint32_t num_inputs,
+                     double scale, double offset) {
+    memset(h, 0, sizeof(*h));
+    memcpy(h->magic, SCT_MAGIC, sizeof(h->magic));
+    h->version = SCT_VERSION;
+    h->dtype = dtype;
+    h->num_traces = num_traces;
+    h->num_samples = num_samples;
+    h->num_inputs = num_inputs;
+    h->scmd = SCT_SCMD_UNKNOWN;
+    h->scale = dtype == SCT_I16 ? scale : 1.0;
+    h->offset = dtype == SCT_I16 ? offset : 0.0;
+    h->traces_offset = SCT_ALIGN;
+    h->inputs_offset = sct_align(h->traces_offset + num_traces * num_samples * sct_sample_size(dtype));
+    h->index_offset = h->inputs_offset + num_traces * num_inputs * sizeof(double);
+}
+
+sct_status sct_read_header(FILE *f, sct_header *h) {
+    if (fseeko(f, 0, SEEK_SET) != 0 || fread(h, sizeof(*h), 1, f) != 1)
+        return SCT_ERR_IO;
+    if (memcmp(h->magic, SCT_MAGIC, sizeof(h->magic)) != 0 || h->version != SCT_VERSION)
+        return SCT_ERR_FORMAT;
+    if (h->dtype != SCT_F32 && h->dtype != SCT_I16)
+        return SCT_ERR_FORMAT;
+    return SCT_OK;
+}
+
+int sct_fits_i16(const float *x, uint32_t n, double scale, double offset) {
+    for (uint32_t j = 0; j < n; j++) {
+        double raw = nearbyint((x[j] - offset) / scale);
+        if (raw < INT16_MIN || raw > INT16_MAX || (float)(raw * scale + offset) != x[j])
+            return 0;
+    }
+    return 1;
+}
+
+// Zero-fill from the current position up to `to`.
+static sct_status sct_pad_to(FILE *f, uint64_t to) {
+    static const uint8_t zeros[SCT_ALIGN];
+    off_t at = ftello(f);
+    if (at < 0)
+        return SCT_ERR_IO;
+    for (uint64_t left = to - (uint64_t)at; left > 0;) {
+        size_t chunk = left < sizeof(zeros) ? (size_t)left : sizeof(zeros);
+        if (fwrite(zeros, 1, chunk, f) != chunk)
+            return SCT_ERR_IO;
+        left -= chunk;
+    }
+    return SCT_OK;
+}
+
+sct_status sct_writer_open(sct_writer *w, const char *path, const sct_header *h) {
+    memset(w, 0, sizeof(*w));
+    w->header = *h;
+    w->row = malloc((size_t)h->num_samples * sct_sample_size(h->dtype) + 1);
+    if (!w->row)
+        return SCT_ERR_NOMEM;
+    w->f = fopen(path, "wb");
+    if (!w->f) {
+        free(w->row);
+        w->row = NULL;
+        return SCT_ERR_IO;
+    }
+    sct_status st = SCT_ERR_IO;
+    if (fwrite(h, sizeof(*h), 1, w->f) == 1)
+        st = sct_pad_to(w->f, h->traces_offset);
+    if (st != SCT_OK)
+        sct_writer_abort(w);
+    return st;
+}
+
+sct_status sct_writer_append(sct_writer *w, const float *trace) {
+    const sct_header *h = &w->header;
+    if (w->written >= h->num_traces)
+        return SCT_ERR_RANGE;
+    const void *row = trace;
+    if (h->dtype == SCT_I16) {
+        int16_t *q = w->row;
+        const double inv = 1.0 / h->scale;
+        for (uint32_t j = 0; j < h->num_samples; j++) {
+            double raw = nearbyint((trace[j] - h->offset) * inv);
+            if (raw < INT16_MIN || raw > INT16_MAX)
+                return SCT_ERR_RANGE;
+            q[j] = (int16_t)raw;
+        }
+        row = q;
+    }
+    if (fwrite(row, sct_sample_size(h->dtype), h->num_samples, w->f) != h->num_samples)
+        return SCT_ERR_IO;
+    w->written++;
+    return SCT_OK;
+}
+
+static sct_status sct_write_or_zero(FILE *f, const void *data, size_t size, uint64_t count) {
+    if (data)
+        return fwrite(data, size, count, f) == count ? SCT_OK : SCT_ERR_IO;
+    off_t at = ftello(f);
+    return at < 0 ? SCT_ERR_IO : sct_pad_to(f, (uint64_t)at + size * count);
+}
+
+sct_status sct_writer_close(sct_writer *w, const double *inputs, const int32_t *index) {
+    const sct_header *h = &w->header;
+    sct_status st = w->written == h->num_traces ? SCT_OK : SCT_ERR_RANGE;
+    if (st == SCT_OK)
+        st = sct_pad_to(w->f, h->inputs_offset);
+    if (st == SCT_OK)
+        st = sct_write_or_zero(w->f, inputs, sizeof(double), h->num_traces * h->num_inputs);
+    if (st == SCT_OK)
+        st = sct_write_or_zero(w->f, index, sizeof(int32_t), h->num_traces);
+    if (st != SCT_OK) {
+        sct_writer_abort(w);
+        return st;
+    }
+    st = fclose(w->f) == 0 ? SCT_OK : SCT_ERR_IO;
+    w->f = NULL;
+    free(w->row);
+    w->row = NULL;
+    return st;
+}
+
+void sct_writer_abort(sct_writer *w) {
+    if (w->f)
+        fclose(w->f);
+    free(w->row);
+    w->f = NULL;
+    w->row = NULL;
+}
@@ -0,0 +1,91 @@
+/*
+ * Trace store - one campaign in one file, replacing the trace_<n>.txt directories.
+ *
+ *   [0, 128)            sct_header, little-endian
+ *   [traces_offset, +)  N x S samples, row-major (one trace contiguous), SCT_F32 or SCT_I16;
+ *                       page aligned so the payload can be mapped directly
+ *   [inputs_offset, +)  N x num_inputs float64, row r = inputs of trace r (already aligned, no +1)
+ *   [index_offset, +)   N int32, the <n> of the trace_<n>.txt each row came from (capture order)
+ *
+ * An SCT_I16 sample is raw * scale + offset. ChipWhisperer scopes return 10-bit ADC codes as code / 1024 - 0.5, so
+ * those traces store exactly as int16 with scale 1/1024, offset -0.5.
+ */
+#ifndef TRACESTORE_H
+#define TRACESTORE_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define SCT_MAGIC "SCATRACE"
+#define SCT_VERSION 1
+#define SCT_ALIGN 4096
+#define SCT_SCMD_UNKNOWN (-1)
+
+typedef enum sct_dtype_enum {
+    SCT_F32 = 1,
+    SCT_I16 = 2,
+} sct_dtype;
+
+typedef enum sct_status_enum {
+    SCT_OK = 0,
+    SCT_ERR_IO,         // open/read/write failed, errno is set
+    SCT_ERR_FORMAT,     // not a trace store, or an unsupported version/dtype
+    SCT_ERR_NOMEM,
+    SCT_ERR_RANGE,      // a sample does not fit the int16 encoding, or a size is out of range
+} sct_status;
+
+typedef struct sct_header_struct {
+    char magic[8];              // SCT_MAGIC, no terminator
+    uint32_t version;
+    uint32_t dtype;             // sct_dtype
+    uint64_t num_traces;
+    uint32_t num_samples;
+    uint32_t num_inputs;        // columns of the inputs matrix (7 for inputs.txt)
+    int32_t scmd;               // firmware scmd the campaign ran, SCT_SCMD_UNKNOWN if not recorded
+    uint32_t reserved0;
+    uint64_t config_hash;       // sct_hash() of the network_config.h the firmware was built from, 0 if unknown
+    double scale;
+    double offset;
+    uint64_t traces_offset;
+    uint64_t inputs_offset;
+    uint64_t index_offset;
+    uint8_t reserved[40];
+} sct_header;
+
+_Static_assert(sizeof(sct_header) == 128, "sct_header must stay 128 bytes");
+
+const char *sct_strerror(sct_status status);
+
+// FNV-1a 64 - chain calls by passing the previous result as h (start from SCT_HASH_INIT).
+#define SCT_HASH_INIT 0xcbf29ce484222325ull
+uint64_t sct_hash(uint64_t h, const void *data, size_t len);
+
+size_t sct_sample_size(sct_dtype dtype);
+
+// Header for N traces of S samples; fills the offsets. scale/offset are ignored for SCT_F32.
+void sct_header_init(sct_header *h, sct_dtype dtype, uint64_t num_traces, uint32_t num_samples, uint32_t num_inputs,
+                     double scale, double offset);
+sct_status sct_read_header(FILE *f, sct_header *h);
+
+// 1 if every sample of x is exactly raw * scale + offset for some int16 raw.
+int sct_fits_i16(const float *x, uint32_t n, double scale, double offset);
+
+/*
+ * Streaming writer: traces go in one at a time (the converter never holds a campaign in memory), inputs and index
+ * rows are written when the writer closes.
+ */
+typedef struct sct_writer_struct {
+    FILE *f;
+    sct_header header;
+    uint64_t written;
+    void *row;                  // one encoded trace
+} sct_writer;
+
+sct_status sct_writer_open(sct_writer *w, const char *path, const sct_header *h);
+// SCT_I16 rounds to the nearest code; SCT_ERR_RANGE if a sample is outside the int16 range.
+sct_status sct_writer_append(sct_writer *w, const float *trace);
+// inputs (num_traces x num_inputs) and index (num_traces) may be NULL - zeros are written in their place.
+sct_status sct_writer_close(sct_writer *w, const double *inputs, const int32_t *index);
+void sct_writer_abort(sct_writer *w);
+
+#endif
@@ -0,0 +1,169 @@
+"""
+Trace store reader/writer (format: tracestore.h). Pure NumPy - no need for libsca.so.
+
+    store = TraceStore("campaign.sct")
+    X = store.samples()            # (N, S) float32, decoded
+    store.raw                      # (N, S) int16/float32 np.memmap, not decoded
+    store.inputs, store.index      # (N, num_inputs) float64, (N,) int32
+
+Out of core: store.window(qs, qe) is a zero-copy view of the mapped payload, and
+store.iter_blocks() decodes one column block at a time, so nothing ever holds all N x S.
+"""
+import struct
+from pathlib import Path
+from typing import Optional, Union
+
+import numpy as np
+
+MAGIC = b"SCATRACE"
+VERSION = 1
+ALIGN = 4096
+SCMD_UNKNOWN = -1
+F32, I16 = 1, 2
+CW_ADC_SCALE, CW_ADC_OFFSET = 1.0 / 1024.0, -0.5
+
+# magic, version, dtype, num_traces, num_samples, num_inputs, scmd, reserved0, config_hash,
+# scale, offset, traces_offset, inputs_offset, index_offset, reserved[40]
+_HEADER = struct.Struct("<8sIIQIIiIQddQQQ40x")
+assert _HEADER.size == 128
+
+PathLike = Union[str, Path]
+
+
+def config_hash(path: PathLike) -> int:
+    """FNV-1a 64 of a file's bytes - what sct-convert -c stores for network_config.h."""
+    h = 0xCBF29CE484222325
+    for b in Path(path).read_bytes():
+        h = ((h ^ b) * 0x100000001B3) & 0xFFFFFFFFFFFFFFFF
+    return h
+
+
+def is_store(path: PathLike) -> bool:
+    p = Path(path)
+    if not p.is_file():
+        return False
+    with open(p, "rb") as f:
+        return f.read(8) == MAGIC
+
+
+def _align(x: int) -> int:
+    return (x + ALIGN - 1) // ALIGN * ALIGN
+
+
+class TraceStore:
+    def __init__(self, path: PathLike):
+        self.path = Path(path)
+        with open(self.path, "rb") as f:
+            fields = _HEADER.unpack(f.read(_HEADER.size))
+        (magic, version, dtype, self.num_traces, self.num_samples, self.num_inputs, self.scmd, _,
+         self.config_hash, self.scale, self.offset, traces_off, inputs_off, index_off) = fields
+        if magic != MAGIC or version != VERSION or dtype not in (F32, I16):
+            raise ValueError(f"{self.path}: not a supported trace store")
+        self.dtype = np.dtype("<i2") if dtype == I16 else np.dtype("<f4")
+        shape = (self.num_traces, self.num_samples)
+        self.raw = np.memmap(self.path, dtype=self.dtype, mode="r", offset=traces_off, shape=shape)
+        self.inputs = np.fromfile(self.path, dtype="<f8", count=self.num_traces * self.num_inputs,
+                                  offset=inputs_off).reshape(self.num_traces, self.num_inputs)
+        self.index = np.fromfile(self.path, dtype="<i4", count=self.num_traces, offset=index_off)
+
+    @property
+    def shape(self):
+        return self.raw.shape
+
+    def samples(self, rows=None, cols=None, dtype=np.float32) -> np.ndarray:
+        """
+        Decoded samples of raw[rows, cols] (both default to everything) as a new array.
+        """
+        X = self.raw
+        if rows is not None:
+            X = X[rows]
+        if cols is not None:
+            X = X[:, cols]
+        if self.dtype == np.dtype("<i2"):
+            return (X.astype(dtype) * dtype(self.scale) + dtype(self.offset))
+        return np.asarray(X, dtype=dtype)
+
+    def window(self, qs: int = 1, qe: Optional[int] = None) -> np.ndarray:
+        """
+        Zero-copy (N, qe - qs + 1) view of raw samples [qs:qe], 1-based inclusive like the R scripts.
+        """
+        qe = self.num_samples if qe is None else qe
+        if not 1 <= qs <= qe <= self.num_samples:
+            raise ValueError(f"bad window [{qs}, {qe}] for S={self.num_samples}")
+        return self.raw[:, qs - 1:qe]
+
+    def group_rows(self, v: float, column: int = 0):
+        """
+        (fixed_rows, random_rows): rows whose input `column` equals / differs from v.
+        """
+        fixed = self.inputs[:, column] == v
+        return np.flatnonzero(fixed), np.flatnonzero(~fixed)
+
+    def iter_blocks(self, rows=None, qs: int = 1, qe: Optional[int] = None, block: int = 1024,
+                    dtype=np.float64):
+        """
+        Yield (first_sample, decoded block) for consecutive column blocks of window [qs:qe], rows `rows`
+        (default: all). first_sample is 1-based; each block is (len(rows), <= block).
+        """
+        view = self.window(qs, qe)
+        for lo in range(0, view.shape[1], block):
+            cols = view[:, lo:lo + block]
+            X = cols if rows is None else cols[rows]
+            if self.dtype == np.dtype("<i2"):
+                yield qs + lo, X.astype(dtype) * dtype(self.scale) + dtype(self.offset)
+            else:
+                yield qs + lo, np.asarray(X, dtype=dtype)
+
+    def inputs_by_index(self) -> np.ndarray:
+        """
+        The inputs matrix in capture-index order, as inputs.txt had it (rows without a trace are NaN).
+        """
+        out = np.full((int(self.index.max()) + 1, self.num_inputs), np.nan)
+        out[self.index] = self.inputs
+        return out
+
+
+def write_store(
+    path: PathLike,
+    traces: np.ndarray,
+    inputs: np.ndarray,
+    index: Optional[np.ndarray] = None,
+    scmd: int = SCMD_UNKNOWN,
+    config: Optional[PathLike] = None,
+    dtype: str = "auto",
+) -> Path:
+    """
+    Write (N, S) traces and their (N, M) inputs (row r = inputs of trace r) to one store.
+    dtype "auto" keeps ChipWhisperer ADC codes as int16 when they round-trip exactly, float32 otherwise.
+    """
+    traces = np.atleast_2d(np.asarray(traces))
+    inputs = np.asarray(inputs, dtype="<f8").reshape(traces.shape[0], -1)
+    N, S = traces.shape
+    index = np.arange(N, dtype="<i4") if index is None else np.asarray(index, dtype="<i4")
+
+    scale, offset = 1.0, 0.0
+    payload = traces.astype("<f4")
+    if dtype in ("auto", "i16"):
+        codes = np.rint((payload.astype(np.float64) - CW_ADC_OFFSET) / CW_ADC_SCALE)
+        exact = (np.abs(codes).max(initial=0) <= 32767
+                 and np.array_equal((codes * CW_ADC_SCALE + CW_ADC_OFFSET).astype("<f4"), payload))
+        if dtype == "i16" or exact:
+            payload, scale, offset = codes.astype("<i2"), CW_ADC_SCALE, CW_ADC_OFFSET
+    elif dtype != "f32":
+        raise ValueError("dtype must be auto, f32 or i16")
+
+    traces_off = ALIGN
+    inputs_off = _align(traces_off + payload.nbytes)
+    index_off = inputs_off + inputs.nbytes
+    header = _HEADER.pack(MAGIC, VERSION, I16 if payload.dtype == np.dtype("<i2") else F32, N, S,
+                          inputs.shape[1], scmd, 0, config_hash(config) if config else 0, scale, offset,
+                          traces_off, inputs_off, index_off)
+    path = Path(path)
+    with open(path, "wb") as f:
+        f.write(header)
+        f.write(b"\0" * (traces_off - len(header)))
+        f.write(np.ascontiguousarray(payload).tobytes())
+        f.write(b"\0" * (inputs_off - traces_off - payload.nbytes))
+        f.write(np.ascontiguousarray(inputs).tobytes())
+        f.write(index.tobytes())
+    return path
@@ -0,0 +1,281 @@
+#include <math.h>
+#include <stdlib.h>
+
+#include "parallel.h"
+#include "tracemap.h"
+#include "tvla.h"
+
+typedef struct tvla_job_struct {
+    double *state;
+    int num_samples;
+    const sct_view *view;   // set: traces come from the view, traces / traces_f32 are unused
+    const double *traces;
+    const float *traces_f32;
+    int num_traces;
+    const int *group;   // NULL: every trace is in all_group
+    int all_group;
+} tvla_job;
+
+static inline int tvla_group_of(const tvla_job *job, int r) {
+    return job->group ? job->group[r] : job->all_group;
+}
+
+#define TVLA_RAW(x) (x)
+#define TVLA_DECODE(x) ((x) * scale + offset)
+
+// One trace into columns [lo, hi) of one group; inv = 1 / (that group's count including this trace).
+#define TVLA_DEFINE_ROW(name, T, LOAD)                                                             \
+    static inline void name(double *restrict mean, double *restrict m2, const T *restrict x,       \
+                            double inv, int lo, int hi, double scale, double offset) {             \
+        for (int j = lo; j < hi; j++) {                                                            \
+            double v = LOAD(x[j]);                                                                 \
+            double d = v - mean[j];                                                                \
+            mean[j] += d * inv;                                                                    \
+            m2[j] += d * (v - mean[j]);                                                            \
+        }                                                                                          \
+    }
+
+TVLA_DEFINE_ROW(tvla_row_f64, double, TVLA_RAW)
+TVLA_DEFINE_ROW(tvla_row_f32, float, TVLA_RAW)
+TVLA_DEFINE_ROW(tvla_row_i16, int16_t, TVLA_DECODE)
+
+/*
+* Welford over columns [lo, hi) for every trace. The trace loop is outside and the column loop inside, so the
+* per-column updates are independent and vectorise; the counts are per trace, so each thread replays them locally and
+* tvla_run() commits them once.
+*/
+#define TVLA_DEFINE_RANGE(name, T, field, row)                                                     \
+    static void name(void *ctx, int lo, int hi) {                                                  \
+        const tvla_job *job = ctx;                                                                 \
+        const int S = job->num_samples;                                                            \
+        for (int blo = lo; blo < hi; blo += SCA_BLOCK) {                                           \
+            int bhi = blo + SCA_BLOCK < hi ? blo + SCA_BLOCK : hi;                                 \
+            double n[2] = {job->state[0], job->state[1]};                                          \
+            for (int r = 0; r < job->num_traces; r++) {                                            \
+                int g = tvla_group_of(job, r);                                                     \
+                if (g != 0 && g != 1)                                                              \
+                    continue;                                                                      \
+                double *mean = job->state + 2 + 2 * (long)g * S;                                   \
+                row(mean, mean + S, job->field + (long)r * S, 1.0 / ++n[g], blo, bhi, 1.0, 0.0);   \
+            }                                                                                      \
+        }                                                                                          \
+    }
+
+TVLA_DEFINE_RANGE(tvla_range_f64, double, traces, tvla_row_f64)
+TVLA_DEFINE_RANGE(tvla_range_f32, float, traces_f32, tvla_row_f32)
+
+// Same walk over a store view: row r is view row r, decoded from the mapped int16 / float32 payload.
+static void tvla_range_view(void *ctx, int lo, int hi) {
+    const tvla_job *job = ctx;
+    const int S = job->num_samples;
+    const sct_header *h = &job->view->map->header;
+    for (int blo = lo; blo < hi; blo += SCA_BLOCK) {
+        int bhi = blo + SCA_BLOCK < hi ? blo + SCA_BLOCK : hi;
+        double n[2] = {job->state[0], job->state[1]};
+        for (int r = 0; r < job->num_traces; r++) {
+            int g = tvla_group_of(job, r);
+            if (g != 0 && g != 1)
+                continue;
+            double *mean = job->state + 2 + 2 * (long)g * S;
+            const void *x = sct_view_data(job->view, (uint64_t)r);
+            if (h->dtype == SCT_I16)
+                tvla_row_i16(mean, mean + S, x, 1.0 / ++n[g], blo, bhi, h->scale, h->offset);
+            else
+                tvla_row_f32(mean, mean + S, x, 1.0 / ++n[g], blo, bhi, 1.0, 0.0);
+        }
+    }
+}
+
+static void tvla_run(tvla_job *job, int num_threads) {
+    if (job->num_traces <= 0 || job->num_samples <= 0)
+        return;
+    sca_range_fn fn = job->view ? tvla_range_view : job->traces ? tvla_range_f64 : tvla_range_f32;
+    sca_parallel_columns(job->num_samples, num_threads, fn, job);
+    for (int r = 0; r < job->num_traces; r++) {
+        int g = tvla_group_of(job, r);
+        if (g == 0 || g == 1)
+            job->state[g] += 1.0;
+    }
+}
+
+void tvla_update(double *state, const int *num_samples, const double *traces, const int *num_traces,
+                 const int *group, const int *num_threads) {
+    tvla_job job = {state, *num_samples, NULL, traces, NULL, *num_traces, group, 0};
+    tvla_run(&job, *num_threads);
+}
+
+void tvla_update_f32(double *state, const int *num_samples, const float *traces, const int *num_traces,
+                     const int *group, const int *num_threads) {
+    tvla_job job = {state, *num_samples, NULL, NULL, traces, *num_traces, group, 0};
+    tvla_run(&job, *num_threads);
+}
+
+void tvla_update_view(double *state, const sct_view *view, const int *group, int num_threads) {
+    tvla_job job = {state, (int)view->num_samples, view, NULL, NULL, (int)view->num_rows, group, 0};
+    tvla_run(&job, num_threads);
+}
+
+void tvla_merge(double *state, const double *other, const int *num_samples) {
+    const int S = *num_samples;
+    for (int g = 0; g < 2; g++) {
+        double na = state[g], nb = other[g], n = na + nb;
+        if (nb == 0.0)
+            continue;
+        double *mean = state + 2 + 2 * (long)g * S, *m2 = mean + S;
+        const double *mean_b = other + 2 + 2 * (long)g * S, *m2_b = mean_b + S;
+        const double wb = nb / n, wab = na * nb / n;
+        for (int j = 0; j < S; j++) {
+            double d = mean_b[j] - mean[j];
+            mean[j] += d * wb;
+            m2[j] += m2_b[j] + d * d * wab;
+        }
+        state[g] = n;
+    }
+}
+
+// Welch t over columns [lo, hi) of state, with n0 / n1 traces in the two groups.
+static void tvla_t_range(const double *state, int S, double n0, double n1, double *t, int lo, int hi) {
+    if (n0 < 2.0 || n1 < 2.0) {
+        for (int j = lo; j < hi; j++)
+            t[j] = NAN;
+        return;
+    }
+    const double *mean0 = state + 2, *m2_0 = mean0 + S, *mean1 = m2_0 + S, *m2_1 = mean1 + S;
+    // var/n = M2 / (n (n - 1))
+    const double k0 = 1.0 / (n0 * (n0 - 1.0)), k1 = 1.0 / (n1 * (n1 - 1.0));
+    for (int j = lo; j < hi; j++) {
+        double se2 = m2_0[j] * k0 + m2_1[j] * k1;
+        t[j] = se2 > 0.0 ? (mean0[j] - mean1[j]) / sqrt(se2) : NAN;
+    }
+}
+
+void tvla_tvalues(const double *state, const int *num_samples, double *t) {
+    tvla_t_range(state, *num_samples, state[0], state[1], t, 0, *num_samples);
+}
+
+void tvla_welch(const double *fixed, const int *num_fixed, const double *random, const int *num_random,
+                const int *num_samples, const int *num_threads, double *t) {
+    double *state = calloc(TVLA_STATE_SIZE(*num_samples), sizeof(double));
+    if (!state) {
+        for (int j = 0; j < *num_samples; j++)
+            t[j] = NAN;
+        return;
+    }
+    tvla_job job = {state, *num_samples, NULL, fixed, NULL, *num_fixed, NULL, 0};
+    tvla_run(&job, *num_threads);
+    job.traces = random;
+    job.num_traces = *num_random;
+    job.all_group = 1;
+    tvla_run(&job, *num_threads);
+    tvla_tvalues(state, num_samples, t);
+    free(state);
+}
+
+typedef struct tvla_curve_job_struct {
+    double *state;          // scratch accumulator, each range touches only its own columns
+    double *t;              // scratch t-curve
+    double *block_max;      // [block][step] max |t| of that block, NaN if every t there is NaN
+    int num_samples;
+    const double *fixed;
+    const double *random;
+    const int *m;
+    int num_steps;
+} tvla_curve_job;
+
+/*
+* Each cache block runs the whole curve on its own: extend both groups to m[k] traces, take the block's max |t|, move
+* on to m[k + 1]. The block's accumulators stay in L1 and every trace is read once, however many steps there are.
+*/
+static void tvla_curve_range(void *ctx, int lo, int hi) {
+    const tvla_curve_job *job = ctx;
+    const int S = job->num_samples;
+    double *mean0 = job->state + 2, *m2_0 = mean0 + S, *mean1 = m2_0 + S, *m2_1 = mean1 + S;
+    for (int blo = lo; blo < hi; blo += SCA_BLOCK) {
+        int bhi = blo + SCA_BLOCK < hi ? blo + SCA_BLOCK : hi;
+        double *block_max = job->block_max + (long)(blo / SCA_BLOCK) * job->num_steps;
+        int r = 0;
+        for (int k = 0; k < job->num_steps; k++) {
+            for (; r < job->m[k]; r++) {
+                double inv = 1.0 / (r + 1);
+                tvla_row_f64(mean0, m2_0, job->fixed + (long)r * S, inv, blo, bhi, 1.0, 0.0);
+                tvla_row_f64(mean1, m2_1, job->random + (long)r * S, inv, blo, bhi, 1.0, 0.0);
+            }
+            tvla_t_range(job->state, S, r, r, job->t, blo, bhi);
+            double mx = NAN;
+            for (int j = blo; j < bhi; j++) {
+                double a = fabs(job->t[j]);
+                if (a > mx || isnan(mx))
+                    mx = isnan(a) ? mx : a;
+            }
+            block_max[k] = mx;
+        }
+    }
+}
+
+void tvla_power_curve(const double *fixed, const int *num_fixed, const double *random, const int *num_random,
+                      const int *num_samples, const int *m, const int *num_steps, const int *num_threads,
+                      double *max_abs_t) {
+    const int S = *num_samples, K = *num_steps;
+    const int m_max = *num_fixed < *num_random ? *num_fixed : *num_random;
+    for (int k = 0; k < K; k++)
+        max_abs_t[k] = NAN;
+    // checkpoints must be non-decreasing and covered by both groups
+    for (int k = 0; k < K; k++)
+        if (m[k] < 0 || m[k] > m_max || (k > 0 && m[k] < m[k - 1]))
+            return;
+    if (S <= 0 || K <= 0)
+        return;
+
+    int num_blocks = (S + SCA_BLOCK - 1) / SCA_BLOCK;
+    double *state = calloc(TVLA_STATE_SIZE(S), sizeof(double));
+    double *t = malloc((size_t)S * sizeof(double));
+    double *block_max = malloc((size_t)num_blocks * K * sizeof(double));
+    if (state && t && block_max) {
+        tvla_curve_job job = {state, t, block_max, S, fixed, random, m, K};
+        sca_parallel_columns(S, *num_threads, tvla_curve_range, &job);
+        for (int b = 0; b < num_blocks; b++)
+            for (int k = 0; k < K; k++) {
+                double a = block_max[(long)b * K + k];
+                if (a > max_abs_t[k] || isnan(max_abs_t[k]))
+                    max_abs_t[k] = isnan(a) ? max_abs_t[k] : a;
+            }
+    }
+    free(state);
+    free(t);
+    free(block_max);
+}
+
+void sct_tvla_window(const char **path, const int *qs, const int *qe, const double *v, const int *num_threads,
+                     double *t, int *counts, int *status) {
+    sct_map m;
+    sct_view view;
+    *status = sct_map_open(&m, *path);
+    if (*status != SCT_OK)
+        return;
+    if (*qs < 1 || *qe < *qs)
+        *status = SCT_ERR_RANGE;
+    else
+        *status = sct_view_window(&view, &m, (uint32_t)(*qs - 1), (uint32_t)(*qe - *qs + 1));
+    int S = 0;
+    double *state = NULL;
+    int *group = NULL;
+    if (*status == SCT_OK) {
+        S = (int)view.num_samples;
+        state = calloc(TVLA_STATE_SIZE(S), sizeof(double));
+        group = malloc((size_t)view.num_rows * sizeof(int));
+        if (!state || !group)
+            *status = SCT_ERR_NOMEM;
+    }
+    if (*status == SCT_OK) {
+        // fixed: first input == v, as inputs[,1] == v in the R scripts
+        for (uint64_t r = 0; r < view.num_rows; r++)
+            group[r] = m.inputs[r * m.header.num_inputs] == *v ? 0 : 1;
+        tvla_update_view(state, &view, group, *num_threads);
+        tvla_tvalues(state, &S, t);
+        counts[0] = (int)state[0];
+        counts[1] = (int)state[1];
+    }
+    free(state);
+    free(group);
+    sct_map_close(&m);
+}
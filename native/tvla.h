@@ -0,0 +1,59 @@
+/*
+ * Streaming Welch t-test (TVLA) over trace sample columns.
+ *
+ * An accumulator is one caller-owned double buffer of TVLA_STATE_SIZE(S) elements, so R (.C) and Python (ctypes)
+ * can hold it in a plain numeric vector / ndarray. A zeroed buffer is an empty accumulator.
+ *
+ *   [0]              traces seen in group 0 (fixed)
+ *   [1]              traces seen in group 1 (random)
+ *   [2 + 0*S, +S)    running mean, group 0
+ *   [2 + 1*S, +S)    running sum of squared deviations (M2), group 0
+ *   [2 + 2*S, +S)    running mean, group 1
+ *   [2 + 3*S, +S)    M2, group 1
+ *
+ * Traces are row-major: trace r, sample j is traces[r * S + j]. Every scalar is passed by pointer so each entry point
+ * can be called straight from R's .C().
+ */
+#ifndef TVLA_H
+#define TVLA_H
+
+#include "tracemap.h"
+
+#define TVLA_STATE_SIZE(S) (2 + 4 * (long)(S))
+
+// Welford update with num_traces traces. group[r] is 0 or 1; any other value skips that trace.
+void tvla_update(double *state, const int *num_samples, const double *traces, const int *num_traces,
+                 const int *group, const int *num_threads);
+void tvla_update_f32(double *state, const int *num_samples, const float *traces, const int *num_traces,
+                     const int *group, const int *num_threads);
+// Same, reading the traces of a store view in place; group has view->num_rows entries.
+void tvla_update_view(double *state, const sct_view *view, const int *group, int num_threads);
+
+// Chan et al. pairwise merge: state becomes the accumulator of both trace sets.
+void tvla_merge(double *state, const double *other, const int *num_samples);
+
+// Welch t per sample, NaN where a group has fewer than two traces or both variances are zero.
+void tvla_tvalues(const double *state, const int *num_samples, double *t);
+
+// One-shot t-curve of two row-major groups - what t.test() in a sapply over the columns computes.
+void tvla_welch(const double *fixed, const int *num_fixed, const double *random, const int *num_random,
+                const int *num_samples, const int *num_threads, double *t);
+
+/*
+ * Power curve in one pass: max |t| over all samples using the first m[k] traces of each group, for every checkpoint
+ * m[0] <= m[1] <= ... <= min(num_fixed, num_random). NaN for a step where no t is finite (and everywhere if the
+ * checkpoints are out of order or out of range).
+ */
+void tvla_power_curve(const double *fixed, const int *num_fixed, const double *random, const int *num_random,
+                      const int *num_samples, const int *m, const int *num_steps, const int *num_threads,
+                      double *max_abs_t);
+
+/*
+ * TVLA straight from a trace store: window [qs, qe] (1-based, inclusive), fixed = rows whose first input is v.
+ * Streams the mapped store column block by column block, so the campaign never has to fit in memory.
+ * counts gets the fixed / random group sizes, status an sct_status.
+ */
+void sct_tvla_window(const char **path, const int *qs, const int *qe, const double *v, const int *num_threads,
+                     double *t, int *counts, int *status);
+
+#endif
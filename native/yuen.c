@@ -0,0 +1,146 @@
+#include <math.h>
+#include <stdlib.h>
+
+#include "parallel.h"
+#include "yuen.h"
+
+#define YUEN_COLS 16            // columns gathered per pass; selection reorders a private copy of each
+
+typedef struct yuen_job_struct {
+    const double *traces[2];    // fixed, random
+    int num_traces[2];
+    int num_samples;
+    double gamma;
+    double *t;
+    double *df;
+} yuen_job;
+
+// Trimmed mean, winsorized variance and kept count of one column.
+typedef struct yuen_moments_struct {
+    double tmean;
+    double wvar;
+    int h;
+} yuen_moments;
+
+// Moves the a[l, r) that are < pivot (or <= pivot) to the front; returns where they end. No data-dependent branch.
+static inline int yuen_partition(double *a, int l, int r, double pivot, int or_equal) {
+    int i = l;
+    for (int j = l; j < r; j++) {
+        double v = a[j];
+        int front = or_equal ? v <= pivot : v < pivot;
+        a[j] = a[i];
+        a[i] = v;
+        i += front;
+    }
+    return i;
+}
+
+/*
+* k-th smallest of a[0, n), partially reordering a. Three-way split around a median-of-three pivot: below, equal,
+* above. Sample columns are full of ties (ADC codes), so the equal run usually ends the search early.
+*/
+static double yuen_select(double *a, int n, int k) {
+    int l = 0, r = n;
+    while (r - l > 1) {
+        double x = a[l], y = a[l + (r - l) / 2], z = a[r - 1];
+        double pivot = x < y ? (y < z ? y : (x < z ? z : x)) : (x < z ? x : (y < z ? z : y));
+        int lt = yuen_partition(a, l, r, pivot, 0);
+        if (k < lt) {
+            r = lt;
+            continue;
+        }
+        int le = yuen_partition(a, lt, r, pivot, 1);
+        if (k < le)
+            return pivot;
+        l = le;
+    }
+    return a[k];
+}
+
+/*
+* g = floor(gamma * n) values are cut from each tail. After selecting the g-th smallest, everything above it is
+* past index g, so the upper bound is a second selection on that part only. The winsorized values are the column
+* clamped to [lo, hi]; their sum also gives the trimmed sum, since winsorizing replaced g values by lo and g by hi.
+* Sums are taken relative to c, a value inside the column, to keep the one-pass variance from cancelling.
+*/
+static yuen_moments yuen_column(double *a, int n, double gamma) {
+    yuen_moments mo = {NAN, NAN, 0};
+    const int g = (int)floor(gamma * n);
+    mo.h = n - 2 * g;
+    if (mo.h < 2)
+        return mo;
+    double lo = -INFINITY, hi = INFINITY, c = a[0];
+    if (g > 0) {
+        lo = yuen_select(a, n, g);
+        hi = yuen_select(a + g + 1, n - g - 1, n - 2 * g - 2);
+        c = lo;
+    }
+    double s = 0.0, s2 = 0.0;
+    for (int i = 0; i < n; i++) {
+        double w = a[i] < lo ? lo : (a[i] > hi ? hi : a[i]);
+        double d = w - c;
+        s += d;
+        s2 += d * d;
+    }
+    double trimmed = g > 0 ? s - g * (hi - lo) : s;     // sum of the kept values, relative to c (= lo when g > 0)
+    mo.tmean = c + trimmed / mo.h;
+    mo.wvar = (s2 - s * s / n) / (n - 1);
+    if (mo.wvar < 0.0)
+        mo.wvar = 0.0;
+    return mo;
+}
+
+static void yuen_range(void *ctx, int lo, int hi) {
+    const yuen_job *job = ctx;
+    const int S = job->num_samples;
+    const int n_max = job->num_traces[0] > job->num_traces[1] ? job->num_traces[0] : job->num_traces[1];
+    double *cols = malloc((size_t)YUEN_COLS * (n_max > 0 ? n_max : 1) * sizeof(double));
+    for (int j0 = lo; j0 < hi; j0 += YUEN_COLS) {
+        const int w = hi - j0 < YUEN_COLS ? hi - j0 : YUEN_COLS;
+        yuen_moments mo[2][YUEN_COLS];
+        int has_nan[YUEN_COLS] = {0};
+        for (int g = 0; cols && g < 2; g++) {
+            const int n = job->num_traces[g];
+            for (int r = 0; r < n; r++) {
+                const double *x = job->traces[g] + (size_t)r * S + j0;
+                for (int c = 0; c < w; c++) {
+                    cols[(size_t)c * n + r] = x[c];
+                    has_nan[c] |= isnan(x[c]);
+                }
+            }
+            for (int c = 0; c < w; c++)
+                mo[g][c] = has_nan[c] ? (yuen_moments){NAN, NAN, 0} : yuen_column(cols + (size_t)c * n, n, job->gamma);
+        }
+        for (int c = 0; c < w; c++) {
+            double t = NAN, df = NAN;
+            if (cols && mo[0][c].h >= 2 && mo[1][c].h >= 2) {
+                const yuen_moments *a = &mo[0][c], *b = &mo[1][c];
+                double q1 = (job->num_traces[0] - 1) * a->wvar / ((double)a->h * (a->h - 1));
+                double q2 = (job->num_traces[1] - 1) * b->wvar / ((double)b->h * (b->h - 1));
+                double se2 = q1 + q2;
+                if (se2 > 0.0) {
+                    t = (a->tmean - b->tmean) / sqrt(se2);
+                    df = se2 * se2 / (q1 * q1 / (a->h - 1) + q2 * q2 / (b->h - 1));
+                }
+            }
+            job->t[j0 + c] = t;
+            if (job->df)
+                job->df[j0 + c] = df;
+        }
+    }
+    free(cols);
+}
+
+void yuen_tcurve(const double *fixed, const int *num_fixed, const double *random, const int *num_random,
+                 const int *num_samples, const double *gamma, const int *num_threads, double *t, double *df) {
+    yuen_job job = {{fixed, random}, {*num_fixed, *num_random}, *num_samples, *gamma, t, df};
+    if (!(job.gamma >= 0.0 && job.gamma < 0.5) || job.num_traces[0] < 0 || job.num_traces[1] < 0) {
+        for (int j = 0; j < job.num_samples; j++) {
+            t[j] = NAN;
+            if (df)
+                df[j] = NAN;
+        }
+        return;
+    }
+    sca_parallel_columns(job.num_samples, sca_num_threads(*num_threads), yuen_range, &job);
+}
@@ -0,0 +1,22 @@
+/*
+ * Yuen's trimmed-mean t-test per sample column (YTLA).
+ *
+ * With g = floor(gamma * n) the trimmed mean drops the g smallest and g largest values of a column, and the
+ * winsorized variance clamps them to the (g+1)-th smallest / largest. Only those two order statistics are needed, so
+ * they are found by selection (expected O(n)) instead of sorting the column; one pass over the clamped values then
+ * gives both the trimmed mean and the winsorized variance.
+ *
+ * Same conventions as tvla.h: row-major traces, scalars by pointer for R's .C().
+ */
+#ifndef YUEN_H
+#define YUEN_H
+
+/*
+ * Yuen t and Welch-Satterthwaite df per column of fixed vs random, trimming gamma in [0, 0.5) from each tail. t and
+ * df are NaN where either group keeps fewer than 2 values after trimming, holds NaN, or the standard error is zero.
+ * df may be NULL.
+ */
+void yuen_tcurve(const double *fixed, const int *num_fixed, const double *random, const int *num_random,
+                 const int *num_samples, const double *gamma, const int *num_threads, double *t, double *df);
+
+#endif
@@ -0,0 +1,146 @@
+/*
+ * Host benchmark driver (`make host-bench`).
+ *
+ * Runs bench_scmd() for every MAC kernel of scmd 0 and every protected scmd mode of the compiled network config and
+ * prints one CSV row each, with the speedup over the reference forward() and the output error against it. The float
+ * modes that can defer their activations to the end of each layer (set_deferred_activation()) get a second row with
+ * kernel "deferred_act", and all of them once more with kernel "fast_sigmoid" (set_fast_sigmoid()); its error against
+ * exp() alone goes to stderr, with the cycle spread of scmd 0 over the output z (bench_sigmoid_spread()). The host
+ * has an FPU, so the soft-float gain of the table only shows in the 'b' numbers. The shuffled modes come once more as
+ * kernel "masked_shuffle" (set_masked_shuffle()), where pool_refill_cycles shows the cost of fisher_yates_masked(),
+ * and stderr gets its chi-squared against fisher_yates() for every fan-in of the config (bench_shuffle_chi2()).
+ * Cycle counts are rdtsc ticks, so compare them between builds on the same machine - the target numbers come from
+ * the 'b' command. BENCH_ITERATIONS sets the traces per mode, BENCH_NO_HEADER=1 drops the header line.
+ *
+ * BENCH_DUMMIES=1 (`make host-bench-dummies`) prints the dummy MAC sweep instead: scmd 12 for a range of dummies per
+ * neuron up to the calibrated cycle budget (bench_calibrate_dummy_macs()), the schedule_dummy_macs() cycles before the
+ * trigger on their own, the overhead of the whole trace over none and how far that spreads the first multiplication
+ * (bench_dummy_peak_share()).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+
+#ifndef NET_CONFIG_NAME
+#define NET_CONFIG_NAME "default"
+#endif
+
+#define BENCH_DEFAULT_ITERATIONS 100000u
+#define MASK_SCALE 0.3
+#define SHUFFLE_CHI2_DRAWS 200000u
+
+static void bench_dummies(network net, uint32_t iterations) {
+    static const int per_neuron[] = {0, 1, 2, 4, 8, 16};
+    const int saved = get_dummy_macs();
+    int weighted_neurons = 0, last = -1;
+    uint32_t none_cycles = 0, cycles_per_dummy = 0;
+
+    for (int i = 1; i < net.num_layers; i++)
+        weighted_neurons += net.layers[i].num_neurons;
+    const uint32_t budget = bench_calibrate_dummy_macs(net, iterations, &cycles_per_dummy);
+
+    if (!getenv("BENCH_NO_HEADER"))
+        printf("config,dummies_per_neuron,dummy_macs,schedule_cycles,cycles_per_inference,overhead_vs_none,"
+               "budget_cycles,cycles_per_dummy,target_peak_share,traces_factor\n");
+    for (unsigned i = 0; i < sizeof(per_neuron) / sizeof(per_neuron[0]); i++) {
+        int d = set_dummy_macs(per_neuron[i]);
+        if (d == last)      // capped by the buffers or the cycle budget
+            break;
+        last = d;
+        bench_result r = bench_scmd(net, 12, MASK_SCALE, iterations);
+        float share = bench_dummy_peak_share(net, iterations);
+        // overhead of the whole trace, schedule_dummy_macs() before the trigger included
+        const uint32_t total = r.setup_cycles + r.forward_cycles;
+        if (d == 0)
+            none_cycles = total;
+        printf("%s,%d,%d,%u,%u,%.2f,%u,%u,%.3f,%.1f\n", NET_CONFIG_NAME, d, d * weighted_neurons,
+               (unsigned)r.setup_cycles, (unsigned)r.forward_cycles,
+               none_cycles ? (double)total / none_cycles - 1.0 : 0.0, (unsigned)budget, (unsigned)cycles_per_dummy,
+               share, share > 0 ? 1.0 / ((double)share * share) : 0.0);
+    }
+    set_dummy_macs(saved);
+}
+
+static void print_row(const char *kernel, bench_result r, float err, uint32_t reference_cycles) {
+    // jitter on minus jitter off, from two runs: timing noise can make it negative for a mode without jitter
+    uint32_t jitter = r.forward_cycles > r.nojitter_cycles ? r.forward_cycles - r.nojitter_cycles : 0;
+    printf("%s,%u,%s,%u,%u,%u,%.2f,%.2f,%.2e,%u,%u,%u\n", NET_CONFIG_NAME, (unsigned)r.scmd, kernel,
+           (unsigned)r.iterations, (unsigned)r.macs, (unsigned)r.forward_cycles,
+           r.macs ? (double)r.forward_cycles / r.macs : 0.0,
+           r.forward_cycles ? (double)reference_cycles / r.forward_cycles : 0.0, err,
+           (unsigned)r.setup_cycles, (unsigned)jitter,
+           (unsigned)r.refill_cycles);
+}
+
+int main(void) {
+    const char *env = getenv("BENCH_ITERATIONS");
+    uint32_t iterations = (env && *env) ? (uint32_t)strtoul(env, NULL, 0) : BENCH_DEFAULT_ITERATIONS;
+
+    network net = init_network();
+
+    if (getenv("BENCH_DUMMIES")) {
+        bench_dummies(net, iterations);
+        return 0;
+    }
+
+    if (!getenv("BENCH_NO_HEADER"))
+        printf("config,scmd,kernel,iterations,macs,cycles_per_inference,cycles_per_mac,speedup_vs_reference,"
+               "max_abs_err,shuffle_setup_cycles,jitter_cycles,pool_refill_cycles\n");
+
+    // scmd 0 once per MAC kernel, then the protected modes (which always use their own loops)
+    uint32_t reference_cycles = 0;
+    for (int row = 0; row < MAC_NUM_KERNELS + NET_NUM_SCMD - 1; row++) {
+        uint8_t scmd = row < MAC_NUM_KERNELS ? 0 : (uint8_t)(row - MAC_NUM_KERNELS + 1);
+        mac_kernel kernel = row < MAC_NUM_KERNELS ? (mac_kernel)row : MAC_REFERENCE;
+
+        set_mac_kernel(kernel);
+        bench_result r = bench_scmd(net, scmd, MASK_SCALE, iterations);
+        float err = bench_max_abs_error(net, scmd, MASK_SCALE);
+        if (row == 0)
+            reference_cycles = r.forward_cycles;
+
+        print_row(mac_kernel_name(kernel), r, err, reference_cycles);
+    }
+    set_mac_kernel(MAC_REFERENCE);
+
+    // the same float modes with their activations at the end of each layer (scmd 11 always works that way)
+    static const uint8_t deferred_scmds[] = {0, 1, 2, 3, 4, 5, 10, 12};
+    set_deferred_activation(1);
+    for (unsigned i = 0; i < sizeof(deferred_scmds) / sizeof(deferred_scmds[0]); i++) {
+        bench_result r = bench_scmd(net, deferred_scmds[i], MASK_SCALE, iterations);
+        print_row("deferred_act", r, bench_max_abs_error(net, deferred_scmds[i], MASK_SCALE), reference_cycles);
+    }
+    set_deferred_activation(0);
+
+    static const uint8_t float_scmds[] = {0, 1, 2, 3, 4, 5, 10, 11, 12};
+    set_fast_sigmoid(1);
+    for (unsigned i = 0; i < sizeof(float_scmds) / sizeof(float_scmds[0]); i++) {
+        bench_result r = bench_scmd(net, float_scmds[i], MASK_SCALE, iterations);
+        print_row("fast_sigmoid", r, bench_max_abs_error(net, float_scmds[i], MASK_SCALE), reference_cycles);
+    }
+    set_fast_sigmoid(0);
+    fprintf(stderr, "%s: fast_sigmoid() within %.2e of exp()\n", NET_CONFIG_NAME, bench_sigmoid_max_error());
+    uint32_t fast_min, exp_min;
+    uint32_t fast_spread = bench_sigmoid_spread(net, 1, iterations, &fast_min);
+    uint32_t exp_spread = bench_sigmoid_spread(net, 0, iterations, &exp_min);
+    fprintf(stderr, "%s: scmd 0 cycle spread over z: fast_sigmoid %u of %u, exp %u of %u\n", NET_CONFIG_NAME,
+            (unsigned)fast_spread, (unsigned)fast_min, (unsigned)exp_spread, (unsigned)exp_min);
+
+    static const uint8_t shuffled_scmds[] = {1, 4, 5, 7, 9, 10};
+    set_masked_shuffle(1);
+    for (unsigned i = 0; i < sizeof(shuffled_scmds) / sizeof(shuffled_scmds[0]); i++) {
+        bench_result r = bench_scmd(net, shuffled_scmds[i], MASK_SCALE, iterations);
+        print_row("masked_shuffle", r, bench_max_abs_error(net, shuffled_scmds[i], MASK_SCALE), reference_cycles);
+    }
+    set_masked_shuffle(0);
+    for (int i = 1; i < net.num_layers; i++) {
+        const int size = net.layers[i].num_weights;
+        if (i > 1 && size == net.layers[i - 1].num_weights)
+            continue;
+        fprintf(stderr, "%s: shuffle chi2 over %u draws, fan-in %d (%d dof): masked %.1f, plain %.1f\n",
+                NET_CONFIG_NAME, (unsigned)SHUFFLE_CHI2_DRAWS, size, (size - 1) * (size - 1),
+                bench_shuffle_chi2(size, 1, SHUFFLE_CHI2_DRAWS), bench_shuffle_chi2(size, 0, SHUFFLE_CHI2_DRAWS));
+    }
+    return 0;
+}
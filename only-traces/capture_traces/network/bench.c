@@ -0,0 +1,338 @@
+#include "bench.h"
+#include "cycles.h"
+#include "network_config.h"
+#include <math.h>
+#include <string.h>
+
+uint32_t network_num_macs(network net) {
+    uint32_t macs = 0;
+    for (int i = 1; i < net.num_layers; i++)
+        macs += (uint32_t)(net.layers[i].num_neurons * net.layers[i].num_weights);
+    return macs;
+}
+
+// Fresh trace, set up the same way handle() does it
+static void bench_load_input(network net, float input_value) {
+    reset_network(net);
+    for (int i = 0; i < net.layers[0].num_neurons; i++)
+        net.layers[0].a[i] = (i == 0 ? input_value : 0.5f);
+}
+
+// Cheapest back-to-back read of the counter, subtracted from every measurement
+static cycles_t bench_counter_overhead(void) {
+    cycles_t best = (cycles_t)-1;
+    for (int i = 0; i < 32; i++) {
+        cycles_t c0 = cycles_now();
+        cycles_t c1 = cycles_now();
+        if (c1 - c0 < best)
+            best = c1 - c0;
+    }
+    return best;
+}
+
+static uint32_t bench_average(uint64_t total, uint64_t overhead, uint32_t iterations) {
+    if (iterations == 0)
+        return 0;
+    total = total > overhead * iterations ? total - overhead * iterations : 0;
+    return (uint32_t)((total + iterations / 2) / iterations);
+}
+
+bench_result bench_scmd(network net, uint8_t scmd, float mask_scale, uint32_t iterations) {
+    const float inputs[2] = {0.657f, -0.657f};
+    uint64_t setup = 0, fwd = 0, nojitter = 0, refill = 0;
+
+    cycles_init();
+    const cycles_t overhead = bench_counter_overhead();
+
+    // The jitter-on and jitter-off runs are interleaved so clock drift hits both the same way
+    for (uint32_t it = 0; it < iterations; it++) {
+        for (int jitter = 1; jitter >= 0; jitter--) {
+            bench_load_input(net, inputs[it & 1]);
+            jitter_seed(0x9E3779B9u ^ it);
+            jitter_enable(jitter);
+
+            cycles_t c0 = cycles_now();
+            net = prepare_scmd(net, scmd);
+            cycles_t c1 = cycles_now();
+            net = forward_scmd(net, scmd, mask_scale);
+            cycles_t c2 = cycles_now();
+
+            cycles_t c3 = cycles_now();
+            perm_pool_refill(net, 1);
+            cycles_t c4 = cycles_now();
+
+            if (jitter) {
+                setup += c1 - c0;
+                fwd += c2 - c1;
+                refill += c4 - c3;
+            } else {
+                nojitter += c2 - c1;
+            }
+        }
+    }
+    jitter_enable(1);
+
+    bench_result result;
+    result.scmd = scmd;
+    result.iterations = iterations;
+    result.macs = network_num_macs(net);
+    result.setup_cycles = bench_average(setup, overhead, iterations);
+    result.forward_cycles = bench_average(fwd, overhead, iterations);
+    result.nojitter_cycles = bench_average(nojitter, overhead, iterations);
+    result.refill_cycles = bench_average(refill, overhead, iterations);
+    return result;
+}
+
+// Reference outputs for input x: forward() with per-neuron activations and expf(). exps gets the frexpf() exponent of
+// the largest input of every weighted layer, the power-of-two scale a block floating point kernel picks for it.
+static void bench_reference(network net, float x, float *reference, int *exps) {
+    const int deferred = get_deferred_activation();
+    const int fast = get_fast_sigmoid();
+    const layer out = net.layers[net.num_layers - 1];
+
+    bench_load_input(net, x);
+    set_deferred_activation(0);
+    set_fast_sigmoid(0);
+    net = forward(net);
+    set_deferred_activation(deferred);
+    set_fast_sigmoid(fast);
+    for (int j = 0; j < out.num_neurons; j++)
+        reference[j] = out.a[j];
+    for (int i = 0; i + 1 < net.num_layers; i++) {
+        float max_a = 0.0f;
+        for (int k = 0; k < net.layers[i].num_neurons; k++)
+            if (fabsf(net.layers[i].a[k]) > max_a)
+                max_a = fabsf(net.layers[i].a[k]);
+        frexpf(max_a, &exps[i]);
+    }
+}
+
+static float bench_mode_error(network net, uint8_t scmd, float mask_scale, float x, const float *reference) {
+    const layer out = net.layers[net.num_layers - 1];
+    float max_err = 0.0f;
+
+    bench_load_input(net, x);
+    net = prepare_scmd(net, scmd);
+    net = forward_scmd(net, scmd, mask_scale);
+    for (int j = 0; j < out.num_neurons; j++) {
+        float err = fabsf(out.a[j] - reference[j]);
+        if (err > max_err)
+            max_err = err;
+    }
+    return max_err;
+}
+
+/*
+* Largest difference between the outputs of mode scmd (with the current MAC kernel) and the reference forward(),
+* over inputs -2..2 in steps of 1/16384. Masked and reordered kernels differ only by rounding, MAC_Q15_SMLAD by its
+* quantization. Where a layer's largest input crosses a power of two between two steps, the crossing is bisected down
+* to adjacent floats and both are checked too: just below it the input rounds up to the top of its int16 scale, which
+* is where a too wide scale wraps. The reference always activates per neuron and uses expf(), so deferred activations
+* and fast_sigmoid() are checked against it too.
+*/
+#define BENCH_ERROR_STEPS 16384    // per unit of input
+
+float bench_max_abs_error(network net, uint8_t scmd, float mask_scale) {
+    const int L = net.num_layers - 1;
+    float reference[net.layers[L].num_neurons];
+    int exps[L], prev_exps[L], mid_exps[L];
+    float max_err = 0.0f, prev_x = 0.0f;
+
+    for (int step = 0; step <= 4 * BENCH_ERROR_STEPS; step++) {
+        float x = -2.0f + (float)step / BENCH_ERROR_STEPS;
+        bench_reference(net, x, reference, exps);
+        float err = bench_mode_error(net, scmd, mask_scale, x, reference);
+        if (err > max_err)
+            max_err = err;
+
+        if (step > 0 && memcmp(exps, prev_exps, sizeof(exps)) != 0) {
+            float lo = prev_x, hi = x;
+            for (;;) {
+                float mid = lo + 0.5f * (hi - lo);
+                if (mid == lo || mid == hi)
+                    break;
+                bench_reference(net, mid, reference, mid_exps);
+                if (memcmp(mid_exps, prev_exps, sizeof(mid_exps)) == 0)
+                    lo = mid;
+                else
+                    hi = mid;
+            }
+            const float edge[2] = {lo, hi};
+            for (int e = 0; e < 2; e++) {
+                bench_reference(net, edge[e], reference, mid_exps);
+                err = bench_mode_error(net, scmd, mask_scale, edge[e], reference);
+                if (err > max_err)
+                    max_err = err;
+            }
+        }
+        memcpy(prev_exps, exps, sizeof(exps));
+        prev_x = x;
+    }
+    perm_pool_refill(net, 1);
+    return max_err;
+}
+
+/*
+* How well the scmd 12 dummies hide one multiplication - the first of layer 1, neuron 0, whose start is at a fixed
+* time: the share of `iterations` schedules that put it on its most likely step. Dummy and real steps cost the same,
+* so the step is the time; a first-order attack at that point sees the leak scaled by the share and needs about
+* 1 / share^2 times the traces. 1 without dummies.
+*/
+float bench_dummy_peak_share(network net, uint32_t iterations) {
+    const int steps = net.layers[1].num_weights + get_dummy_macs();
+    uint32_t hits[steps];
+    uint32_t peak = 0;
+
+    for (int p = 0; p < steps; p++)
+        hits[p] = 0;
+    for (uint32_t it = 0; it < iterations; it++) {
+        net = schedule_dummy_macs(net);
+        int p = dummy_mac_step(net, 1, 0, 0);
+        if (p >= 0 && ++hits[p] > peak)
+            peak = hits[p];
+    }
+    return iterations ? (float)peak / iterations : 0.0f;
+}
+
+/*
+* Largest difference between fast_sigmoid() and 1 / (1 + exp(-z)) in double, over z = -24..24 in steps of 1/4096 -
+* both sides of the saturation at 16 and every interpolation interval at 256 points.
+*/
+float bench_sigmoid_max_error(void) {
+    double max_err = 0.0;
+
+    for (int i = -24 * 4096; i <= 24 * 4096; i++) {
+        float z = i / 4096.0f;
+        double err = fabs((double)fast_sigmoid(z) - 1.0 / (1.0 + exp(-(double)z)));
+        if (err > max_err)
+            max_err = err;
+    }
+    return (float)max_err;
+}
+
+/*
+* How much the output sigmoid's time depends on z: scmd 0 timed as in bench_scmd() while every output bias is shifted
+* by -20..20, so each output z walks through both saturated tails and the middle of the sigmoid. Activations are
+* deferred, which makes the ReLU branch-free too, and jitter is off. Each offset keeps its fastest trace rather than
+* the average - host scheduling noise moves averages by more than the effect looked for, while the target's counts
+* are the same every trace - and the offsets take turns within every iteration, so clock drift hits them alike.
+* Returns the slowest minus the fastest offset, min_cycles (if not NULL) gets the fastest.
+* fast picks fast_sigmoid() or expf(); the switches and biases are restored afterwards.
+*/
+#define BENCH_SPREAD_OFFSET 20
+
+uint32_t bench_sigmoid_spread(network net, int fast, uint32_t iterations, uint32_t *min_cycles) {
+    static float bias[NET_TOTAL_NEURONS];
+    cycles_t fastest[2 * BENCH_SPREAD_OFFSET + 1];
+    const layer out = net.layers[net.num_layers - 1];
+    const int deferred = get_deferred_activation(), saved = get_fast_sigmoid();
+    uint32_t lo = 0xFFFFFFFFu, hi = 0;
+
+    cycles_init();
+    const cycles_t overhead = bench_counter_overhead();
+    memcpy(bias, out.bias, out.num_neurons * sizeof(float));
+    set_deferred_activation(1);
+    set_fast_sigmoid(fast);
+    jitter_enable(0);
+    for (int k = 0; k <= 2 * BENCH_SPREAD_OFFSET; k++)
+        fastest[k] = (cycles_t)-1;
+    for (uint32_t it = 0; it < iterations; it++) {
+        for (int k = 0; k <= 2 * BENCH_SPREAD_OFFSET; k++) {
+            for (int j = 0; j < out.num_neurons; j++)
+                out.bias[j] = bias[j] + (float)(k - BENCH_SPREAD_OFFSET);
+            bench_load_input(net, 0.657f);
+            net = prepare_scmd(net, 0);
+            cycles_t c0 = cycles_now();
+            net = forward_scmd(net, 0, 0.0f);
+            cycles_t c1 = cycles_now();
+            if (c1 - c0 < fastest[k])
+                fastest[k] = c1 - c0;
+        }
+    }
+    for (int k = 0; k <= 2 * BENCH_SPREAD_OFFSET; k++) {
+        const uint32_t cycles = (uint32_t)(fastest[k] > overhead ? fastest[k] - overhead : 0);
+        if (cycles < lo)
+            lo = cycles;
+        if (cycles > hi)
+            hi = cycles;
+    }
+    jitter_enable(1);
+    set_deferred_activation(deferred);
+    set_fast_sigmoid(saved);
+    memcpy(out.bias, bias, out.num_neurons * sizeof(float));
+    if (min_cycles)
+        *min_cycles = lo;
+    return hi - lo;
+}
+
+/*
+* The scmd 12 cycle budget, measured: traces (schedule_dummy_macs() + forward) with no dummies, one per neuron and as
+* many as the buffers hold. The first two give the fixed cost of having dummies at all, the last two the cycles each
+* further dummy MAC adds, both rounded up. The budget is DUMMY_MACS_CYCLE_BUDGET_PCT percent of the dummy-free trace.
+* All three go to set_dummy_mac_budget(), which re-caps the current dummy count. Returns the budget in cycles,
+* cycles_per_dummy (if not NULL) gets the per-dummy cost.
+*/
+static uint32_t bench_dummy_trace_cycles(network net, int per_neuron, uint32_t iterations) {
+    set_dummy_macs(per_neuron);
+    bench_result r = bench_scmd(net, 12, 0.0f, iterations);
+    return r.setup_cycles + r.forward_cycles;
+}
+
+uint32_t bench_calibrate_dummy_macs(network net, uint32_t iterations, uint32_t *cycles_per_dummy) {
+    const int saved = get_dummy_macs();
+    uint32_t neurons = 0;
+    for (int i = 1; i < net.num_layers; i++)
+        neurons += (uint32_t)net.layers[i].num_neurons;
+
+    set_dummy_mac_budget(0, 0, 0);
+    const int most = set_dummy_macs(1 << 30);
+    const uint32_t none = bench_dummy_trace_cycles(net, 0, iterations);
+    const uint32_t one = most > 0 ? bench_dummy_trace_cycles(net, 1, iterations) : none;
+    const uint32_t full = most > 1 ? bench_dummy_trace_cycles(net, most, iterations) : one;
+
+    const uint32_t dummies = most > 1 ? (uint32_t)(most - 1) * neurons : 0;
+    uint32_t per = dummies && full > one ? (full - one + dummies - 1) / dummies : 0;
+    if (per == 0)
+        per = 1;
+    const uint32_t fixed = one > none + per * neurons ? one - none - per * neurons : 0;
+    const uint32_t budget = (uint32_t)((uint64_t)none * DUMMY_MACS_CYCLE_BUDGET_PCT / 100);
+
+    set_dummy_macs(saved);
+    set_dummy_mac_budget(fixed, per, budget);
+    if (cycles_per_dummy)
+        *cycles_per_dummy = per;
+    return budget;
+}
+
+/*
+* Pearson's chi-squared of fisher_yates_masked() (masked) or fisher_yates() over `draws` shuffles of size elements:
+* how often each value lands on each position, against draws / size. Rows and columns both sum to draws, so a uniform
+* shuffle scores around (size - 1)^2 (the degrees of freedom); a biased index shows as a multiple of that.
+* Returns -1 above BENCH_UNIFORMITY_MAX_SIZE.
+*/
+#define BENCH_UNIFORMITY_MAX_SIZE 32
+
+float bench_shuffle_chi2(int size, int masked, uint32_t draws) {
+    static uint32_t counts[BENCH_UNIFORMITY_MAX_SIZE * BENCH_UNIFORMITY_MAX_SIZE];
+    int arr[BENCH_UNIFORMITY_MAX_SIZE];
+
+    if (size < 1 || size > BENCH_UNIFORMITY_MAX_SIZE)
+        return -1.0f;
+    memset(counts, 0, sizeof(counts));
+    for (uint32_t d = 0; d < draws; d++) {
+        for (int i = 0; i < size; i++)
+            arr[i] = i;
+        if (masked)
+            fisher_yates_masked(arr, size);
+        else
+            fisher_yates(arr, size);
+        for (int i = 0; i < size; i++)
+            counts[i * size + arr[i]]++;
+    }
+
+    const double expected = (double)draws / size;
+    double chi2 = 0.0;
+    for (int i = 0; i < size * size; i++)
+        chi2 += (counts[i] - expected) * (counts[i] - expected) / expected;
+    return (float)chi2;
+}
@@ -0,0 +1,32 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+#include "network.h"
+
+/*
+* Cost of one scmd mode, averaged over `iterations` traces. All values are cycles per trace from cycles_now(),
+* minus the cost of reading the counter itself. The 'b' command replies with it as is: seven little-endian uint32 in
+* field order, which native/targetbench.py turns into the bench-host CSV rows - keep the two in step.
+*/
+typedef struct bench_result_struct {
+    uint32_t scmd;
+    uint32_t iterations;
+    uint32_t macs;              // multiply-accumulates per inference
+    uint32_t setup_cycles;      // prepare_scmd() - the shuffle_mul_indices* setup before the trigger
+    uint32_t forward_cycles;    // forward_scmd() - what lands inside the trigger window
+    uint32_t nojitter_cycles;   // forward_scmd() again with the delay_jitter_cycles() loops switched off
+    uint32_t refill_cycles;     // perm_pool_refill() of the slot the trace used - idle time, after the response
+} bench_result;
+typedef char bench_result_is_seven_words[sizeof(bench_result) == 7 * sizeof(uint32_t) ? 1 : -1];
+
+uint32_t network_num_macs(network net);
+bench_result bench_scmd(network net, uint8_t scmd, float mask_scale, uint32_t iterations);
+float bench_max_abs_error(network net, uint8_t scmd, float mask_scale);
+float bench_dummy_peak_share(network net, uint32_t iterations);
+uint32_t bench_calibrate_dummy_macs(network net, uint32_t iterations, uint32_t *cycles_per_dummy);
+float bench_sigmoid_max_error(void);
+uint32_t bench_sigmoid_spread(network net, int fast, uint32_t iterations, uint32_t *min_cycles);
+float bench_shuffle_chi2(int size, int masked, uint32_t draws);
+
+#endif
@@ -0,0 +1,37 @@
+/*
+ * Cycle counter shared by the firmware and the host build.
+ *
+ * On target this is the Cortex-M4 DWT CYCCNT (32 bit, wraps after ~10 min at 7.37 MHz - fine for one trace).
+ * On host it is host_cycles(), i.e. rdtsc on x86.
+ */
+#ifndef CYCLES_H
+#define CYCLES_H
+
+#include <stdint.h>
+
+#if defined(HOST_BUILD) || defined(DEBUGGING)
+#include "host-timer.h"
+
+typedef uint64_t cycles_t;
+
+static inline void cycles_init(void) {}
+static inline cycles_t cycles_now(void) { return host_cycles(); }
+
+#else
+
+typedef uint32_t cycles_t;
+
+#define CYCLES_DEMCR      (*(volatile uint32_t *)0xE000EDFCu)
+#define CYCLES_DWT_CTRL   (*(volatile uint32_t *)0xE0001000u)
+#define CYCLES_DWT_CYCCNT (*(volatile uint32_t *)0xE0001004u)
+
+static inline void cycles_init(void) {
+    CYCLES_DEMCR |= (1u << 24);     // TRCENA - power up the DWT
+    CYCLES_DWT_CYCCNT = 0;
+    CYCLES_DWT_CTRL |= 1u;          // CYCCNTENA
+}
+static inline cycles_t cycles_now(void) { return CYCLES_DWT_CYCCNT; }
+
+#endif
+
+#endif
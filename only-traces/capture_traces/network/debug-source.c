@@ -3,6 +3,7 @@
 #include <stdlib.h>
 
 #include "main.h"
+#include "host-hal.h"
 
 
 
@@ -14,11 +15,11 @@ uint8_t UART_SETUP = 0;
 uint8_t PLATFORM_SETUP = 0;
 uint8_t SS_SETUP = 0;
 
-void platform_init() {
+void platform_init(void) {
     printf("Initiated platform!\n");
     PLATFORM_SETUP = 1;
 }
-void init_uart() {
+void init_uart(void) {
     if (PLATFORM_SETUP == 0) {
         printf("Tried to setup UART without Platform setup");
         exit(-1);
@@ -26,7 +27,7 @@ void init_uart() {
     printf("Initiated UArt!\n");
     UART_SETUP = 1;
 }
-void trigger_setup() {
+void trigger_setup(void) {
     if (UART_SETUP == 0) {
         printf("Tried to setup Trigger without UART setup");
         exit(-1);
@@ -34,14 +35,14 @@ void trigger_setup() {
     printf("Trigger Setup!\n");
     TRIGGER_SETUP = 1;
 }
-void trigger_high() {
+void trigger_high(void) {
     if (TRIGGER_SETUP == 0) {
         printf("Tried to set trigger to high without trigger setup");
         exit(-1);
     }
     printf("Trigger put at High!\n");
 }
-void trigger_low() {
+void trigger_low(void) {
     if (TRIGGER_SETUP == 0) {
         printf("Tried to set trigger to low without trigger setup");
         exit(-1);
@@ -49,7 +50,7 @@ void trigger_low() {
     printf("Trigger put at Low!\n");
 }
 
-void simpleserial_init() {
+void simpleserial_init(void) {
     if (TRIGGER_SETUP == 0) {
         printf("Tried to setup SimpleSerial without Trigger setup");
         exit(-1);
@@ -57,7 +58,7 @@ void simpleserial_init() {
     printf("Initiated SimpleSerial!\n");
     SS_SETUP = 1;
 }
-void simpleserial_put(uint8_t cmd, uint8_t len, uint8_t* buf) {
+void simpleserial_put(char cmd, uint8_t len, uint8_t* buf) {
     printf("Put '%c' on SS with len %u", cmd, len);
     printf("Data: [\n");
 
@@ -69,10 +70,11 @@ void simpleserial_put(uint8_t cmd, uint8_t len, uint8_t* buf) {
 
     printf("\n]\n");
 }
-void simpleserial_addcmd(uint8_t cmd, uint8_t len, uint8_t (*f)(uint8_t cmd, uint8_t scmd, uint8_t len, uint8_t *buf)) {
+int simpleserial_addcmd(char cmd, unsigned int len, uint8_t (*f)(uint8_t cmd, uint8_t scmd, uint8_t len, uint8_t *buf)) {
     printf("Listening for '%c' on SS with preferred len %u\n", cmd, len);
+    return 0;
 }
-void simpleserial_get(uint8_t cmd, uint8_t len, uint8_t (*f)(uint8_t cmd, uint8_t scmd, uint8_t len, uint8_t *buf)) {
+void simpleserial_get(void) {
     // Put your debug code here
     printf("Debugging started!\n");
     
@@ -0,0 +1,137 @@
+/*
+ * Stub HAL for the Linux host build (`make host`).
+ *
+ * Instead of waiting for a capture board, simpleserial_get() calls the registered 'p' handler HOST_ITERATIONS times
+ * (default 1000000) for every scmd mode and prints one CSV row per mode, then exits. Alternating fixed inputs are
+ * sent, as in a fixed-vs-fixed capture. Set HOST_SCMD to run a single mode.
+ * If a 'q' handler is registered the same traces are then pushed through it, HOST_BATCH (default 20) inputs per
+ * command; those rows report the cost per trace, not per command.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host-hal.h"
+#include "network.h"
+#include "host-timer.h"
+
+#define HOST_NUM_SCMD NET_NUM_SCMD
+#define HOST_DEFAULT_ITERATIONS 1000000ul
+#define HOST_WARMUP_ITERATIONS 1000ul
+#define HOST_MAX_CMDS 16
+#define HOST_DEFAULT_BATCH 20ul
+#define HOST_MAX_BATCH 62
+
+static struct {
+    char c;
+    unsigned int len;
+    uint8_t (*fp)(uint8_t, uint8_t, uint8_t, uint8_t*);
+} host_cmds[HOST_MAX_CMDS];
+static int host_num_cmds = 0;
+
+// Kept so the harness can check every trigger_high() got its trigger_low()
+static volatile uint32_t host_trigger_count = 0;
+static volatile uint32_t host_put_count = 0;
+
+void platform_init(void) {}
+void init_uart(void) {}
+void trigger_setup(void) {}
+void trigger_high(void) { host_trigger_count++; }
+void trigger_low(void) { host_trigger_count--; }
+
+void simpleserial_init(void) {}
+
+int simpleserial_addcmd(char c, unsigned int len, uint8_t (*fp)(uint8_t, uint8_t, uint8_t, uint8_t*)) {
+    if (host_num_cmds >= HOST_MAX_CMDS)
+        return 1;
+    host_cmds[host_num_cmds].c = c;
+    host_cmds[host_num_cmds].len = len;
+    host_cmds[host_num_cmds].fp = fp;
+    host_num_cmds++;
+    return 0;
+}
+
+void simpleserial_put(char c, uint8_t size, uint8_t* output) {
+    (void)c; (void)size; (void)output;
+    host_put_count++;
+}
+
+static unsigned long env_ulong(const char *name, unsigned long fallback) {
+    const char *value = getenv(name);
+    return (value && *value) ? strtoul(value, NULL, 0) : fallback;
+}
+
+static uint8_t (*find_cmd(char c))(uint8_t, uint8_t, uint8_t, uint8_t*) {
+    for (int i = 0; i < host_num_cmds; i++) {
+        if (host_cmds[i].c == c)
+            return host_cmds[i].fp;
+    }
+    return NULL;
+}
+
+// Times `calls` invocations of handler with `len` bytes of buf and prints one CSV row for `traces` traces
+static void run_cmd(char c, uint8_t (*handler)(uint8_t, uint8_t, uint8_t, uint8_t*), int scmd,
+                    uint8_t buffers[2][HOST_MAX_BATCH * sizeof(float)], uint8_t len,
+                    unsigned long calls, unsigned long traces) {
+    for (unsigned long i = 0; i < HOST_WARMUP_ITERATIONS; i++)
+        handler(c, scmd, len, buffers[i & 1]);
+
+    uint32_t puts_before = host_put_count;
+    uint64_t t0 = host_time_ns();
+    uint64_t c0 = host_cycles();
+    for (unsigned long i = 0; i < calls; i++) {
+        if (handler(c, scmd, len, buffers[i & 1]) != 0) {
+            fprintf(stderr, "host: '%c' scmd %d returned an error\n", c, scmd);
+            exit(1);
+        }
+    }
+    uint64_t c1 = host_cycles();
+    uint64_t t1 = host_time_ns();
+
+    if (host_trigger_count != 0 || host_put_count - puts_before != (uint32_t)calls) {
+        fprintf(stderr, "host: '%c' scmd %d left the trigger high or dropped a response\n", c, scmd);
+        exit(1);
+    }
+
+    double ns = (double)(t1 - t0);
+    printf("%c,%d,%lu,%.0f,%.1f,%.1f\n", c, scmd, traces,
+           ns > 0 ? traces * 1e9 / ns : 0.0,
+           traces ? ns / traces : 0.0,
+           traces ? (double)(c1 - c0) / traces : 0.0);
+}
+
+void simpleserial_get(void) {
+    uint8_t (*handler)(uint8_t, uint8_t, uint8_t, uint8_t*) = find_cmd('p');
+    uint8_t (*batch_handler)(uint8_t, uint8_t, uint8_t, uint8_t*) = find_cmd('q');
+    if (!handler) {
+        fprintf(stderr, "host: no 'p' handler registered\n");
+        exit(1);
+    }
+
+    const unsigned long iterations = env_ulong("HOST_ITERATIONS", HOST_DEFAULT_ITERATIONS);
+    const int only_scmd = getenv("HOST_SCMD") ? (int)env_ulong("HOST_SCMD", 0) : -1;
+    unsigned long batch = env_ulong("HOST_BATCH", HOST_DEFAULT_BATCH);
+    if (batch == 0 || batch > HOST_MAX_BATCH)
+        batch = HOST_DEFAULT_BATCH;
+
+    // buffers[0] holds the fixed inputs in even traces, buffers[1] the odd ones - also for 'q', as two batches
+    const float inputs[2] = {0.657f, -0.657f};
+    static uint8_t buffers[2][HOST_MAX_BATCH * sizeof(float)];
+    for (unsigned long t = 0; t < HOST_MAX_BATCH * 2; t++)
+        memcpy(&buffers[t & 1][(t / 2) * sizeof(float)], &inputs[t & 1], sizeof(float));
+
+    printf("cmd,scmd,traces,traces_per_s,ns_per_trace,cycles_per_trace\n");
+    for (int scmd = 0; scmd < HOST_NUM_SCMD; scmd++) {
+        if (only_scmd >= 0 && scmd != only_scmd)
+            continue;
+        run_cmd('p', handler, scmd, buffers, sizeof(float), iterations, iterations);
+    }
+    for (int scmd = 0; batch_handler && scmd < HOST_NUM_SCMD; scmd++) {
+        if (only_scmd >= 0 && scmd != only_scmd)
+            continue;
+        unsigned long calls = iterations / batch;
+        run_cmd('q', batch_handler, scmd, buffers, batch * sizeof(float), calls, calls * batch);
+    }
+
+    exit(0);
+}
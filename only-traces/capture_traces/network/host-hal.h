@@ -0,0 +1,32 @@
+/*
+ * Host stand-in for the ChipWhisperer HAL and SimpleSerial headers.
+ *
+ * main.c includes this instead of hal/hal.h and simpleserial/simpleserial.h when built with -DHOST_BUILD
+ * (see `make host`) or -DDEBUGGING. The prototypes match the SS_VER_2_1 firmware so main.c needs no other changes.
+ * host-hal.c implements them as a throughput harness, debug-source.c as a single printing run.
+ */
+#ifndef HOST_HAL_H
+#define HOST_HAL_H
+
+#include <stdint.h>
+
+// SimpleSerial v2.1 error codes used by the handlers
+#define SS_ERR_OK 0x00
+#define SS_ERR_CMD 0x01
+#define SS_ERR_CRC 0x02
+#define SS_ERR_TIMEOUT 0x03
+#define SS_ERR_LEN 0x04
+#define SS_ERR_FRAME_BYTE 0x05
+
+void platform_init(void);
+void init_uart(void);
+void trigger_setup(void);
+void trigger_high(void);
+void trigger_low(void);
+
+void simpleserial_init(void);
+int simpleserial_addcmd(char c, unsigned int len, uint8_t (*fp)(uint8_t, uint8_t, uint8_t, uint8_t*));
+void simpleserial_get(void);
+void simpleserial_put(char c, uint8_t size, uint8_t* output);
+
+#endif
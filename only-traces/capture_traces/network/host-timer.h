@@ -0,0 +1,31 @@
+/*
+ * Host timing for the HOST_BUILD / DEBUGGING paths.
+ *
+ * host_time_ns() is CLOCK_MONOTONIC wall time, host_cycles() is the TSC on x86 and falls back to nanoseconds
+ * elsewhere. Neither is used in the firmware - see cycles.h for the target counter.
+ */
+#ifndef HOST_TIMER_H
+#define HOST_TIMER_H
+
+#include <stdint.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+static inline uint64_t host_time_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static inline uint64_t host_cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return host_time_ns();
+#endif
+}
+
+#endif
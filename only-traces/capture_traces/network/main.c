@@ -6,75 +6,74 @@
  */
 
 /*
- * When debugging locally compile using `gcc -o debug-app.exe main.c network.c debug-source.c -DDEBUGGING=1`
+ * When debugging locally compile using `gcc -o debug-app main.c network.c debug-source.c -DDEBUGGING=1 -lm`
+ * For the host throughput harness use `make host` (see host-hal.c)
  */
 #define fixedvsfixed
 #define MASK_SCALE 0.3
+// SimpleSerial v2.1 payload limit (249) rounded down to whole floats - caps both the 'q' inputs (62 floats)
+// and its outputs (20 passes of a 3 neuron output layer)
+#define BATCH_MAX_BYTES 248
+#define DUMMY_MACS_CALIBRATION_TRACES 64   // per measurement of bench_calibrate_dummy_macs() at startup
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include "network.h"
-#include "network_config.h"
-
+#include "bench.h"
+#include "rng.h"
+#include "cycles.h"
+#include "markers.h"
+
+#if defined(HOST_BUILD) || defined(DEBUGGING)
+#include "host-hal.h"
+#include "host-timer.h"
+#else
 #include "hal/hal.h"
 #include "hal/stm32f3/stm32f3_hal.h"
+#endif
 
 #define SS_VER SS_VER_2_1
 static uint32_t trace_counter = 0;
+static network net; // built once in main(), only reset per trace
 
 
+#if !defined(HOST_BUILD) && !defined(DEBUGGING)
 #include "simpleserial/simpleserial.h"
+#endif
 
-#ifdef DEBUGGING  // If debugging import windows for QueryPerformanceCounter() to measure overhead time with high resolution
-#include <windows.h>
+#ifdef DEBUGGING  // If debugging, host-timer.h gives the high resolution clock used to measure overhead time
 
 /// A Debugging test handle 
 uint8_t test_handle(uint8_t cmd, uint8_t scmd, uint8_t len, uint8_t *buf)
 {
   int arr[7] = {0, 1, 2, 3, 4, 5, 6};
-  unsigned int s1[7] = {1, 1, 1, 3, 2, 1, 4};
-  unsigned int s2[7] = {1, 1, 1, 3, 3, 1, 2};
-  unsigned int length = 0;
-  unsigned int num_of_neurons = 7; 
-  while (num_of_neurons > 0) {
-    num_of_neurons >>= 1;
-    length++;
-  }
 
-  // fisher_yates_masked(arr, 7, s1, s2, length);
+  fisher_yates_masked(arr, 7);
 
-  // printf("Shuffled array: ");
-  // for (int i = 0; i < 7; i++) {
-  //   printf("%d", arr[i]);
-  // }
-  for (int i=6; i > 1; i--){
-    unsigned int j = modulo_masked(i, s1, s2, length);
-    printf("%d", j);
+  printf("Shuffled array: ");
+  for (int i = 0; i < 7; i++) {
+    printf("%d", arr[i]);
   }
   printf("\n");
   return 0;
 }
 #endif 
 
-/// This function will handle the 'p' command send from the capture board.
-uint8_t handle(uint8_t cmd, uint8_t scmd, uint8_t len, uint8_t *buf)
+/// Loads one input into a freshly reset network - shared by the 'p' and 'q' commands.
+static void load_input(float input_value)
 {
-  int num_layers = NET_NUM_LAYERS;
-  int *num_neurons_arr = NET_NUM_NEURONS;
-  
-  network net = init_network(num_layers, num_neurons_arr, net_config_layer_weights);
+  // only the activations and the multiplication orders change between traces
+  reset_network(net);
 
-  float input_value;
-  memcpy(&input_value, buf, sizeof(float));
-  //net.layers[0].neurons[0].a = input_value;
-  ///net.layers[0].neurons[1].a = input_value;
+  //net.layers[0].a[0] = input_value;
+  ///net.layers[0].a[1] = input_value;
   int n0 = net.layers[0].num_neurons; 
 
   //fixed vs fixed exp 
   #ifdef fixedvsfixedexp 
 
     for (int i =0; i<n0; i++){ 
-      net.layers[0].neurons[i].a = input_value; 
+      net.layers[0].a[i] = input_value; 
     }
 
   #endif
@@ -82,78 +81,55 @@ uint8_t handle(uint8_t cmd, uint8_t scmd, uint8_t len, uint8_t *buf)
   #ifndef fixedvsfixedexp 
   
   for (int i = 0; i < n0; i++) {
-      net.layers[0].neurons[i].a = (i == (0) ? input_value : 0.5f);
+      net.layers[0].a[i] = (i == (0) ? input_value : 0.5f);
   }
 
   #endif
+}
+
+/// This function will handle the 'p' command send from the capture board.
+uint8_t handle(uint8_t cmd, uint8_t scmd, uint8_t len, uint8_t *buf)
+{
+  float input_value;
+  memcpy(&input_value, buf, sizeof(float));
+  load_input(input_value);
+  rng_stir(cycles_now());
   
 
 
   #ifdef DEBUGGING
   #if 1
-  LARGE_INTEGER frequency, start, middle, end;
+  uint64_t start, middle, end;
   double overhead_time, forward_pass_time, overall_time;
-  // Get the frequency of the performance counter
-  QueryPerformanceFrequency(&frequency);
-  QueryPerformanceCounter(&start);
+  start = host_time_ns();
   #endif
   #endif
   //scmd = 0; 
   
 
-  if (scmd == 1 || scmd == 4 || scmd == 5) {
-    for (int i = 1; i < net.num_layers; i++) {
-     
-     net = shuffle_mul_indices(net, i);
-     //net = shuffle_mul_indices_deranged(net, i);
-     //net = shuffle_mul_indices(net, i);
-    }
-    //net = shuffle_mul_indices_deranged(net, 1);
-    //net = shuffle_mul_indices_masked(net, 1);
-    //net = shuffle_mul_indices(net, 1);
-  }
+  net = prepare_scmd(net, scmd);
   jitter_seed(0x9E3779B9u ^ trace_counter++);
 
 
   #ifdef DEBUGGING
   #if 1
   //print_network(net);
-  QueryPerformanceCounter(&middle);
+  middle = host_time_ns();
   #endif
   #endif
 
+#ifdef TRACE_MARKERS
+  markers_clear();
+#endif
   // Start Measurement
   trigger_high(); 
-  switch (scmd) {
-    case 0: // unprotected
-        net = forward(net);
-        break;
-
-    case 1: // shuffled only
-        net = forward_shuffled(net);
-        break;
-
-    case 2: // masked (per neuron)
-        net = forward_masked_neuron(net, MASK_SCALE);
-        break;
-
-    case 3: // masked (per multiply)
-        net = forward_masked_mul(net, MASK_SCALE);
-        break;
-
-    case 4: // shuffled + masked (per neuron)
-        net = forward_shuffled_masked_neuron(net, MASK_SCALE);
-        break;
-
-    case 5: // shuffled + masked (per multiply)
-        net = forward_shuffled_masked_mul(net, MASK_SCALE);
-        break;
-
-    default:
-        // fallback: 
-        net = forward(net);
-        break;
-  }
+#ifdef TRACE_MARKERS
+  markers_begin();
+#endif
+  net = forward_scmd(net, scmd, MASK_SCALE);
+#ifdef TRACE_MARKERS
+  markers_end();
+#endif
 
   // Stop Measurement
   trigger_low();
@@ -161,40 +137,156 @@ uint8_t handle(uint8_t cmd, uint8_t scmd, uint8_t len, uint8_t *buf)
 
   #ifdef DEBUGGING
   #if 1
-  QueryPerformanceCounter(&end);
-  overhead_time = (double)(middle.QuadPart - start.QuadPart) / frequency.QuadPart;
-  overall_time = (double)(end.QuadPart - start.QuadPart) / frequency.QuadPart;
-  forward_pass_time = (double)(end.QuadPart - middle.QuadPart) / frequency.QuadPart;
+  end = host_time_ns();
+  overhead_time = (double)(middle - start) / 1e9;
+  overall_time = (double)(end - start) / 1e9;
+  forward_pass_time = (double)(end - middle) / 1e9;
   double percentage = overhead_time / overall_time * 100;
   print_network(net);
-  printf("Overall Time: %.16f\nForward Pass Time: %.16f\nOverhead Time: %.16f\nOverhead/Total percentage: %.16f\%\n", overall_time, forward_pass_time, overhead_time , percentage);
+  printf("Overall Time: %.16f\nForward Pass Time: %.16f\nOverhead Time: %.16f\nOverhead/Total percentage: %.16f%%\n", overall_time, forward_pass_time, overhead_time , percentage);
   
   #endif
   #endif
   
-  //free dynamically allocated memory
-  free_network(&net);
-  
+#ifdef TRACE_MARKERS
+  // the echoed input, then the layer / neuron stamps of this trace (markers.h)
+  uint8_t response[sizeof(float) + MARKERS_MAX * sizeof(uint32_t)];
+  memcpy(response, buf, sizeof(float));
+  simpleserial_put('r', sizeof(float) + markers_copy(&response[sizeof(float)]), response);
+#else
   simpleserial_put('r', len, buf);
+#endif
+
+  // idle time until the next command - top the permutation pool back up
+  perm_pool_refill(net, 1);
+
+  return 0;
+}
+
+/// This function will handle the 'q' command: one forward pass per float in buf, each inside its own trigger pulse
+/// (one segment in the scope's segmented mode). Returns the output layer activations of every pass, in order.
+uint8_t handle_batch(uint8_t cmd, uint8_t scmd, uint8_t len, uint8_t *buf)
+{
+  static float outputs[BATCH_MAX_BYTES / sizeof(float)];
+  const layer out = net.layers[net.num_layers - 1];
+  unsigned int n = len / sizeof(float);
+
+  if (n == 0 || len % sizeof(float) != 0 || n * out.num_neurons * sizeof(float) > BATCH_MAX_BYTES)
+    return SS_ERR_LEN;
+
+  rng_stir(cycles_now());
+  for (unsigned int t = 0; t < n; t++) {
+    float input_value;
+    memcpy(&input_value, &buf[t * sizeof(float)], sizeof(float));
+    load_input(input_value);
+
+    net = prepare_scmd(net, scmd);
+    jitter_seed(0x9E3779B9u ^ trace_counter++);
+
+    trigger_high();
+    net = forward_scmd(net, scmd, MASK_SCALE);
+    trigger_low();
+
+    memcpy(&outputs[t * out.num_neurons], out.a, out.num_neurons * sizeof(float));
+  }
+
+  simpleserial_put('r', n * out.num_neurons * sizeof(float), (uint8_t *)outputs);
+
+  perm_pool_refill(net, n);
+  return 0;
+}
+
+/// This function will handle the 'k' command: scmd picks the MAC kernel used by scmd 0 from now on (see mac_kernel).
+/// Returns the kernel actually selected - out of range values fall back to MAC_REFERENCE.
+uint8_t handle_kernel(uint8_t cmd, uint8_t scmd, uint8_t len, uint8_t *buf)
+{
+  set_mac_kernel((mac_kernel)scmd);
+  uint8_t selected = (uint8_t)get_mac_kernel();
+  simpleserial_put('r', 1, &selected);
+  return 0;
+}
+
+/// This function will handle the 'a' command: scmd 1 defers the activations of the float modes to the end of each
+/// layer from now on, 0 goes back to per neuron. Returns the setting.
+uint8_t handle_activation(uint8_t cmd, uint8_t scmd, uint8_t len, uint8_t *buf)
+{
+  set_deferred_activation(scmd);
+  uint8_t selected = (uint8_t)get_deferred_activation();
+  simpleserial_put('r', 1, &selected);
+  return 0;
+}
+
+/// This function will handle the 'g' command: scmd 1 switches the output sigmoid of the float modes to the table
+/// version from now on, 0 back to expf(). Returns the setting.
+uint8_t handle_sigmoid(uint8_t cmd, uint8_t scmd, uint8_t len, uint8_t *buf)
+{
+  set_fast_sigmoid(scmd);
+  uint8_t selected = (uint8_t)get_fast_sigmoid();
+  simpleserial_put('r', 1, &selected);
+  return 0;
+}
+
+/// This function will handle the 'm' command: scmd 1 shuffles the multiplication orders with fisher_yates_masked()
+/// from now on, 0 goes back to fisher_yates(). Returns the setting.
+uint8_t handle_shuffle(uint8_t cmd, uint8_t scmd, uint8_t len, uint8_t *buf)
+{
+  set_masked_shuffle(scmd);
+  uint8_t selected = (uint8_t)get_masked_shuffle();
+  simpleserial_put('r', 1, &selected);
+  return 0;
+}
+
+/// This function will handle the 'd' command: scmd dummy MACs per neuron for scmd 12 from now on.
+/// Returns the count actually kept - capped by the buffers and the cycle budget measured at startup.
+uint8_t handle_dummies(uint8_t cmd, uint8_t scmd, uint8_t len, uint8_t *buf)
+{
+  uint8_t kept = (uint8_t)set_dummy_macs(scmd);
+  simpleserial_put('r', 1, &kept);
+  return 0;
+}
+
+/// This function will handle the 'b' command: benchmark mode scmd on the target and return a bench_result
+/// (layout in bench.h, decoded by native/targetbench.py). buf holds the number of iterations as a little-endian
+/// uint32_t.
+uint8_t handle_bench(uint8_t cmd, uint8_t scmd, uint8_t len, uint8_t *buf)
+{
+  if (len != sizeof(uint32_t))
+    return SS_ERR_LEN;
+
+  uint32_t iterations;
+  memcpy(&iterations, buf, sizeof(uint32_t));
+  bench_result result = bench_scmd(net, scmd, MASK_SCALE, iterations);
 
+  simpleserial_put('r', sizeof(bench_result), (uint8_t *)&result);
   return 0;
 }
 
 int main(void) {
-  srand(time(NULL));
-  //Initialize network weights
-  init_weights();
+  cycles_init();
+  rng_seed_device();
+  //Build the network once from network_config.h - handle() only resets it
+  net = init_network();
+  set_mac_kernel(MAC_KERNEL);
   // Setup the specific chipset.
   platform_init();
   // Setup serial communication line.
   init_uart();
   // Setup measurement trigger.
   trigger_setup();
+  // scmd 12 cycle budget, measured on this clock
+  bench_calibrate_dummy_macs(net, DUMMY_MACS_CALIBRATION_TRACES, NULL);
 
   simpleserial_init();
 
   // Insert your handlers here.
   simpleserial_addcmd('p', 1*sizeof(float), handle);
+  simpleserial_addcmd('q', BATCH_MAX_BYTES, handle_batch);
+  simpleserial_addcmd('b', sizeof(uint32_t), handle_bench);
+  simpleserial_addcmd('k', 0, handle_kernel);
+  simpleserial_addcmd('d', 0, handle_dummies);
+  simpleserial_addcmd('a', 0, handle_activation);
+  simpleserial_addcmd('g', 0, handle_sigmoid);
+  simpleserial_addcmd('m', 0, handle_shuffle);
 
 #ifdef DEBUGGING
   simpleserial_addcmd('t', 16, test_handle);
@@ -1,6 +1,13 @@
 #include <stdint.h>
 
 uint8_t handle(uint8_t cmd, uint8_t scmd, uint8_t len, uint8_t *buf);
+uint8_t handle_batch(uint8_t cmd, uint8_t scmd, uint8_t len, uint8_t *buf);
+uint8_t handle_kernel(uint8_t cmd, uint8_t scmd, uint8_t len, uint8_t *buf);
+uint8_t handle_bench(uint8_t cmd, uint8_t scmd, uint8_t len, uint8_t *buf);
+uint8_t handle_dummies(uint8_t cmd, uint8_t scmd, uint8_t len, uint8_t *buf);
+uint8_t handle_activation(uint8_t cmd, uint8_t scmd, uint8_t len, uint8_t *buf);
+uint8_t handle_sigmoid(uint8_t cmd, uint8_t scmd, uint8_t len, uint8_t *buf);
+uint8_t handle_shuffle(uint8_t cmd, uint8_t scmd, uint8_t len, uint8_t *buf);
 #ifdef DEBUGGING
 uint8_t test_handle(uint8_t cmd, uint8_t scmd, uint8_t len, uint8_t *buf);
 #endif
\ No newline at end of file
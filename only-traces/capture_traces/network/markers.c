@@ -0,0 +1,59 @@
+#include "markers.h"
+
+#ifdef TRACE_MARKERS
+
+#include <string.h>
+#include "network_config.h"
+
+// MARK_LAYER() indexes marker_layer_slot with every layer of the forward loops
+#if NET_NUM_LAYERS > MARKERS_MAX_LAYERS
+#error "TRACE_MARKERS supports at most MARKERS_MAX_LAYERS layers - raise it for this config"
+#endif
+
+uint32_t marker_stamps[MARKERS_MAX];
+int marker_layer_slot[MARKERS_MAX_LAYERS];
+cycles_t marker_t0;
+static int marker_count, marker_end_slot;
+
+/*
+* One slot per weighted layer followed by one per neuron, then the end of the pass. Slots past MARKERS_MAX are
+* dropped by marker_stamp(), so a topology too big for one response only loses its tail.
+*/
+void markers_init(network net) {
+    int slot = 0;
+    for (int i = 1; i < net.num_layers && i < MARKERS_MAX_LAYERS; i++){
+        marker_layer_slot[i] = slot;
+        slot += 1 + net.layers[i].num_neurons;
+    }
+    marker_end_slot = slot;
+    marker_count = (slot + 1 < MARKERS_MAX) ? slot + 1 : MARKERS_MAX;
+}
+
+int markers_count(void) {
+    return marker_count;
+}
+
+void markers_clear(void) {
+    memset(marker_stamps, 0xFF, sizeof(marker_stamps));
+}
+
+void markers_begin(void) {
+    marker_t0 = cycles_now();
+}
+
+void markers_end(void) {
+    marker_stamp(marker_end_slot);
+}
+
+uint8_t markers_copy(uint8_t *out) {
+    for (int s = 0; s < marker_count; s++){
+        uint32_t v = marker_stamps[s];
+        out[4 * s]     = (uint8_t)v;
+        out[4 * s + 1] = (uint8_t)(v >> 8);
+        out[4 * s + 2] = (uint8_t)(v >> 16);
+        out[4 * s + 3] = (uint8_t)(v >> 24);
+    }
+    return (uint8_t)(4 * marker_count);
+}
+
+#endif
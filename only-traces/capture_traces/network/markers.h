@@ -0,0 +1,61 @@
+/*
+ * Trigger-window markers - where each layer and neuron starts inside the trace. Build with -DTRACE_MARKERS
+ * (`make TRACE_MARKERS=1`, or HOST_DEFS=-DTRACE_MARKERS for the host builds); without it the macros below are empty
+ * and the firmware is the one the campaigns were captured with.
+ *
+ * Every forward variant stamps the cycle counter at the start of each weighted layer and of each neuron, relative to
+ * the trigger_high() of the 'p' command. Each operation has its own slot, so a stamp says which operation it is
+ * whatever order a shuffled variant visits them in:
+ *
+ *   layer 1, its neurons 0 .. n-1, layer 2, its neurons, ..., the output layer's last neuron, end of the forward pass
+ *
+ * handle() appends the slots to its 'r' response as little-endian uint32 after the echoed input. A slot the mode does
+ * not stamp (the neurons of the eight-wide SIMD kernel and of the MAC grid shuffle, scmd 11) stays MARKER_NONE.
+ * A neuron's window runs up to the next stamp in time, so the kernels that activate a whole layer at once charge the
+ * activations to its last neuron.
+ * native/markers.py and native/markers.R turn the stamps into sample windows.
+ *
+ * A stamp is one counter read and one store; a marker build is that much slower per neuron than the plain one, so
+ * take the windows from the build you capture.
+ */
+#ifndef MARKERS_H
+#define MARKERS_H
+
+#include <stdint.h>
+#include "network.h"
+#include "cycles.h"
+
+#define MARKERS_MAX 61              // what fits in one 'r' payload (249 bytes) after the echoed float
+#define MARKERS_MAX_LAYERS 8
+#define MARKER_NONE 0xFFFFFFFFu
+
+#ifdef TRACE_MARKERS
+
+extern uint32_t marker_stamps[MARKERS_MAX];
+extern int marker_layer_slot[MARKERS_MAX_LAYERS];
+extern cycles_t marker_t0;
+
+void markers_init(network net);     // slot layout from the topology - called by init_network()
+int markers_count(void);
+void markers_clear(void);           // before trigger_high(), so the stores stay out of the trace
+void markers_begin(void);           // right after trigger_high() - one counter read
+void markers_end(void);             // right before trigger_low()
+uint8_t markers_copy(uint8_t *out); // little-endian stamps, returns the number of bytes written
+
+static inline void marker_stamp(int slot) {
+    if (slot < MARKERS_MAX) {
+        marker_stamps[slot] = (uint32_t)(cycles_now() - marker_t0);
+    }
+}
+
+#define MARK_LAYER(layer_idx) marker_stamp(marker_layer_slot[layer_idx])
+#define MARK_NEURON(layer_idx, neuron_idx) marker_stamp(marker_layer_slot[layer_idx] + 1 + (neuron_idx))
+
+#else
+
+#define MARK_LAYER(layer_idx) ((void)0)
+#define MARK_NEURON(layer_idx, neuron_idx) ((void)0)
+
+#endif
+
+#endif
@@ -1,60 +1,77 @@
 #include "network.h"
+#include "network_config.h"
+#include "rng.h"
+#include "qnetwork.h"
+#include "markers.h"
 #include <stdint.h>
+#include <string.h>
 #include <math.h>
 
-unsigned int blakely(unsigned int a, unsigned int b, unsigned int n, unsigned int length) {
-    unsigned int R = 0;
-    for (int i = length - 1; i >= 0; i--) {
-        unsigned int ai = (a >> i) & 1;
-        R = 2 * R + ai * b;
-        if (R >= n) {
-            R = R - n;
-        }
-        if (R >= n) {
-            R = R - n;
-        }
-    }
-    return R;
-}
-
-unsigned int modulo_masked(int i, unsigned int s1[], unsigned int s2[], unsigned int length) {
-    unsigned int r1 = rand();
-    unsigned int r2 = rand();
-    unsigned int tmp = (r1 * (s1[i] % (i + 1)) + r2 * (i + 1)) % (i + 1);
-    // Compute (tmp * s2[i]) % (i + 1)
-    unsigned int j = blakely(tmp, (s2[i] % (i + 1)), i + 1, length);
-    return j;
-}
-
-void fisher_yates_masked(int arr[], unsigned int size, unsigned int s1[], unsigned int s2[], unsigned int length) {
-    #ifdef DEBUGGING
-    #if 0
-    printf("arr: ");
-    for (int i=0; i<size; i++)printf("%d", arr[i]);
-    printf(" size: %d, s1: ", size);
-    for (int i=0; i<size; i++)printf("%d", s1[i]);
-    printf(" s2: ");
-    for (int i=0; i<size; i++)printf("%d", s2[i]);
-    printf(" length: %d Shuffled arr: ", length);
-    #endif
-    #endif
-    for (int i = size - 1; i >= 2; i--) {
-        unsigned int j = modulo_masked(i, s1, s2, length);
-        unsigned int temp = arr[i];
-        arr[i] = arr[j];
-        arr[j] = temp;
-    }
-    unsigned int j = rand() % 2;
-    unsigned int temp = arr[1];
-    arr[1] = arr[j];
-    arr[j] = temp;
-
-    #ifdef DEBUGGING
-    #if 0
-    for (int i=0; i<size; i++)printf("%d", arr[i]);
-    printf("\n");
-    #endif
-    #endif
+#ifndef PERM_POOL_DEPTH
+#define PERM_POOL_DEPTH 4   // pre-shuffled slots, each NET_TOTAL_WEIGHTS ints (2 KB for the large config)
+#endif
+
+static void perm_pool_init(network net);
+static qnetwork qnet;   // fixed-point twin used by scmd 6-9, built by init_network()
+static void mac_kernels_init(network net);
+static void dummy_macs_init(network net);
+#if defined(__x86_64__) && (defined(HOST_BUILD) || defined(DEBUGGING))
+static void mac_simd_init(network net);
+#endif
+
+/*
+* Masked bounded indices for fisher_yates_masked(). The index j in [0, n) is drawn as two additive shares u and v,
+* each a fresh rng_u32() reduced mod n, and only exists as j = u + v mod n in the last step. Each share alone is
+* uniform and independent of j, so the multiplies of the reductions never handle j. After that j is in the clear -
+* it addresses the swap - so the mask covers the reductions, not the swap's loads and stores. Every reduction is
+* Lemire's fastmod with M = ceil(2^64 / n) precomputed per bound: no division, no loop, no branch, at two rng_u32()
+* per index. A 32 bit draw mod n is off uniform by at most n / 2^32, and so is j.
+*/
+#define MASKED_MOD_BOUNDS (NET_TOTAL_NEURONS + 1)   // covers every fan-in
+
+static struct {
+    uint64_t m[MASKED_MOD_BOUNDS];      // fastmod constant of n
+} masked_mod;
+
+static int net_masked_shuffle = MASKED_SHUFFLE;
+
+// a mod n for any 32 bit a, from M = ceil(2^64 / n): the high word of (M * a mod 2^64) * n, in 32 x 32 multiplies
+static inline uint32_t fastmod_u32(uint32_t a, uint64_t m, uint32_t n) {
+    const uint64_t low = m * a;
+    const uint64_t mid = (((uint64_t)(uint32_t)low * n) >> 32) + (low >> 32) * n;
+    return (uint32_t)(mid >> 32);
+}
+
+static void masked_mod_init(void) {
+    for (uint32_t n = 1; n < MASKED_MOD_BOUNDS; n++){
+        masked_mod.m[n] = UINT64_C(0xFFFFFFFFFFFFFFFF) / n + 1;    // wraps to 0 for n = 1, which gives a mod 1 = 0
+    }
+}
+
+// Uniform in [0, n), 0 < n < MASKED_MOD_BOUNDS
+unsigned int modulo_masked(unsigned int n) {
+    const uint64_t m = masked_mod.m[n];
+    const uint32_t u = fastmod_u32(rng_u32(), m, n);
+    const uint32_t v = fastmod_u32(rng_u32(), m, n);
+    // u + v < 2n: take n off when it is at least n, the mask from the sign of n - 1 - (u + v)
+    const uint32_t sum = u + v;
+    const uint32_t wrap = (uint32_t)((int32_t)(n - 1 - sum) >> 31);
+    return sum - (n & wrap);
+}
+
+void set_masked_shuffle(int enabled) {
+    net_masked_shuffle = enabled ? 1 : 0;
+}
+
+int get_masked_shuffle(void) {
+    return net_masked_shuffle;
+}
+
+void fisher_yates_masked(int arr[], int size) {
+    for (int i = size - 1; i > 0; i--) {
+        int j = (int)modulo_masked((unsigned int)i + 1);
+        swap(&arr[i], &arr[j]);
+    }
 }
 
 void swap(int *a, int *b){
@@ -68,14 +85,14 @@ void swap(int *a, int *b){
 */
 void fisher_yates(int arr[], int size){
     for (int i = size - 1; i > 0; i--) {
-        int j = rand() % (i + 1);
+        int j = rng_below(i + 1);
         swap(&arr[i], &arr[j]);
     }
 }
 
 void fisher_yates_deranged(int arr[], int size){
     for (int i = size - 1; i > 0; i--) {
-        int j = rand() % (i + 1);
+        int j = rng_below(i + 1);
         swap(&arr[i], &arr[j]);
     }
 
@@ -85,7 +102,7 @@ void fisher_yates_deranged(int arr[], int size){
 
                 int swap_index = -1;
                 do {
-                    swap_index = rand() % size;
+                    swap_index = rng_below(size);
                 } while (swap_index == i);
 
                 swap(&arr[i], &arr[swap_index]);
@@ -96,18 +113,6 @@ void fisher_yates_deranged(int arr[], int size){
 
 
 
-void free_network(network *net){
-    // free the dynamically allocated fields inside the network struct
-    for (int i=0; i < net->num_layers; i++){
-        for(int j=0; j< net->layers[i].num_neurons; j++){
-            if (net->layers[i].neurons[j].weights != NULL) free(net->layers[i].neurons[j].weights);
-            if (net->layers[i].neurons[j].mul_indices != NULL) free(net->layers[i].neurons[j].mul_indices);
-        }
-        free(net->layers[i].neurons);
-    }
-    free(net->layers);
-}
-
 /*
 * Prints out the values contained withing the network - number of layers, and then for each layer prints out each neuron
 * for each neuron this prints out the a value, the z value, and the weight values (an array of size equal to the number of neurons in the previous layer - except for the first layer - the input layer ) 
@@ -119,16 +124,17 @@ void print_network(network net){
     for (int i = 0; i < net.num_layers; i++){
         printf("Layer %d:\n", i);
         for (int j = 0; j < net.layers[i].num_neurons; j++){
-            printf("\tNeuron %d | a=%f z=%f\t| ", j, net.layers[i].neurons[j].a,  net.layers[i].neurons[j].z );
+            printf("\tNeuron %d | a=%f z=%f\t| ", j, net.layers[i].a[j],  net.layers[i].z[j] );
             if (i >= 1){
+                int num_weights = net.layers[i].num_weights;
                 printf("Mul Indices: ");
-                for (int k = 0; k < net.layers[i - 1].num_neurons; k++){
-                    printf("%d", net.layers[i].neurons[j].mul_indices[k]);
+                for (int k = 0; k < num_weights; k++){
+                    printf("%d", net.layers[i].mul_indices[j * num_weights + k]);
                 }
                 printf("\tWeights: {");
-                for (int k = 0; k < net.layers[i - 1].num_neurons; k++){
-                    printf("%f", net.layers[i].neurons[j].weights[k]);
-                    if (k < net.layers[i - 1].num_neurons - 1)
+                for (int k = 0; k < num_weights; k++){
+                    printf("%f", net.layers[i].weights[j * num_weights + k]);
+                    if (k < num_weights - 1)
                     printf(", ");
                     else
                     printf("}");
@@ -140,80 +146,94 @@ void print_network(network net){
     printf("-----------------------------------------------------------------------------------------------------------------------------------------------------------------\n");
 }
 
+/*
+* The one arena backing the network - sized from network_config.h at build time.
+* Weights are not part of it, the layers point straight into the const tables from the config.
+*/
+static struct {
+    layer layers[NET_NUM_LAYERS];
+    float bias[NET_TOTAL_NEURONS];
+    float z[NET_TOTAL_NEURONS];
+    float a[NET_TOTAL_NEURONS];
+    int mul_indices[NET_TOTAL_WEIGHTS];
+    int neuron_order[NET_TOTAL_NEURONS];
+    int mac_order[NET_TOTAL_WEIGHTS];
+    int weight_offset[NET_NUM_LAYERS]; // where each layer starts in mul_indices (and in a perm_pool slot)
+} net_arena;
 
-neuron create_neuron(void* weights, int num_in_weights, int layer_idx, int neuron_idx){
-    neuron new_neuron;
-    new_neuron.a = 0.5;
-    new_neuron.z = 0.0;
-    new_neuron.bias = 0.0;
-    new_neuron.num_weights = num_in_weights;
-
-    if (num_in_weights > 0) {
-        new_neuron.weights = (float*) malloc(num_in_weights * sizeof(float));
-        new_neuron.mul_indices = (int*) malloc(num_in_weights * sizeof(int));
-    } else {
-        new_neuron.weights = NULL;
-        new_neuron.mul_indices = NULL;
-    }
-    if (weights != NULL && num_in_weights > 0){
-        //TODO: Dont question it... it works.
-        float (*layer_weights)[num_in_weights] = ((float (*)[num_in_weights])((float**)weights)[layer_idx]);
-        for (int i=0; i<num_in_weights; i++){
-            new_neuron.weights[i] = layer_weights[neuron_idx][i];
-            new_neuron.mul_indices[i] = i;
+/*
+* Wires the layers up to the arena and the weight tables. Meant to be called once at startup -
+* per trace only reset_network() is needed.
+*/
+network init_network(void) {
+    network net;
+    int *num_neurons = NET_NUM_NEURONS;
+    int neuron_offset = 0, weight_offset = 0;
+
+    net.num_layers = NET_NUM_LAYERS;
+    net.layers = net_arena.layers;
+    for (int i = 0; i < NET_NUM_LAYERS; i++){
+        layer *lay = &net.layers[i];
+        lay->num_neurons = num_neurons[i];
+        lay->num_weights = (i > 0) ? num_neurons[i - 1] : 0;
+        lay->weights = net_config_layer_weights[i];
+        lay->bias = &net_arena.bias[neuron_offset];
+        lay->z = &net_arena.z[neuron_offset];
+        lay->a = &net_arena.a[neuron_offset];
+        lay->mul_indices = &net_arena.mul_indices[weight_offset];
+        lay->neuron_order = &net_arena.neuron_order[neuron_offset];
+        lay->mac_order = &net_arena.mac_order[weight_offset];
+        net_arena.weight_offset[i] = weight_offset;
+        for (int j = 0; j < lay->num_neurons; j++){
+            lay->bias[j] = 0.0;
+            lay->neuron_order[j] = j;
         }
+        for (int k = 0; k < lay->num_neurons * lay->num_weights; k++){
+            lay->mac_order[k] = k;
+        }
+        neuron_offset += lay->num_neurons;
+        weight_offset += lay->num_neurons * lay->num_weights;
     }
-    return new_neuron;
-}
-
-layer create_layer(int num_neurons){
-    layer lay;
-    lay.num_neurons = num_neurons;
-    lay.neurons = (neuron*) malloc(num_neurons * sizeof(neuron));
-    return lay;
-}
-
-network create_network(int num_layers){
-    network net;
-    net.num_layers = num_layers;
-    net.layers = (layer*) malloc(num_layers * sizeof(layer));
+    reset_network(net);
+    masked_mod_init();
+    perm_pool_init(net);
+    qnet = init_qnetwork();
+    mac_kernels_init(net);
+    dummy_macs_init(net);
+#if defined(__x86_64__) && (defined(HOST_BUILD) || defined(DEBUGGING))
+    mac_simd_init(net);
+#endif
+#ifdef TRACE_MARKERS
+    markers_init(net);
+#endif
     return net;
 }
 
-network init_network(int num_layers, int *num_neurons, void* weights) {
-    network net = create_network(num_layers);
-    int curr_layer_idx, curr_neuron_idx;
-    for (curr_layer_idx = 0; curr_layer_idx < num_layers; curr_layer_idx++){
-        net.layers[ curr_layer_idx ] = create_layer(num_neurons[ curr_layer_idx ]);
-    }
-    // create neurons for the first (input) layer - they dont have weights
-    for (curr_neuron_idx = 0; curr_neuron_idx < net.layers[0].num_neurons; curr_neuron_idx++){
-        net.layers[0].neurons[ curr_neuron_idx ] = create_neuron(NULL, 0, 0, curr_neuron_idx);
-    }
-    // For each following layer create neurons with number of weights eqaual to the number of neurons in the previous layer
-    for (curr_layer_idx = 1; curr_layer_idx < num_layers; curr_layer_idx++){
-        int prev_layer_idx = curr_layer_idx - 1;
-        for (curr_neuron_idx = 0; curr_neuron_idx <net.layers[ curr_layer_idx ].num_neurons; curr_neuron_idx++){
-            net.layers[ curr_layer_idx ].neurons[ curr_neuron_idx ] = create_neuron(weights, net.layers[ prev_layer_idx ].num_neurons, curr_layer_idx, curr_neuron_idx );
+/*
+* Brings the per-trace state back to its initial values - a = 0.5, z = 0 and the multiplication order to identity.
+* mul_indices is pointed back at the arena in case the last trace borrowed a perm_pool slot.
+* Weights and bias are left untouched, and so are neuron_order and mac_order - Fisher-Yates over the last trace's
+* permutation is as uniform as over the identity.
+*/
+void reset_network(network net) {
+    for (int i = 0; i < net.num_layers; i++){
+        net.layers[i].mul_indices = &net_arena.mul_indices[net_arena.weight_offset[i]];
+        layer lay = net.layers[i];
+        for (int j = 0; j < lay.num_neurons; j++){
+            lay.a[j] = 0.5;
+            lay.z[j] = 0.0;
+            for (int k = 0; k < lay.num_weights; k++){
+                lay.mul_indices[j * lay.num_weights + k] = k;
+            }
         }
     }
-    return net;
 }
 
 
 network shuffle_mul_indices_masked(network net, int layer_idx) {
-   unsigned int s1[] = {1,1,1,3,2,1,4}; //2,3,1,4,1,2,3,1};
-    unsigned int  s2[] = {1,1,1,3,3,1,2}; //3,1,2,1,4,2,1,3};
-
-    unsigned int length = 0;
-    unsigned int num_of_neurons = net.layers[ layer_idx ].num_neurons; 
-    while (num_of_neurons > 0) {
-        num_of_neurons >>= 1;
-        length++;
-    }
     if (layer_idx > 0 && layer_idx < net.num_layers) {
         for (int i = 0; i < net.layers[ layer_idx ].num_neurons; i++){
-            fisher_yates_masked(net.layers[ layer_idx ].neurons[ i ].mul_indices, net.layers[ layer_idx ].neurons[ i ].num_weights, s1, s2, length);
+            fisher_yates_masked(&net.layers[ layer_idx ].mul_indices[ i * net.layers[ layer_idx ].num_weights ], net.layers[ layer_idx ].num_weights);
         }
     }
     return net;
@@ -222,207 +242,568 @@ network shuffle_mul_indices_masked(network net, int layer_idx) {
 network shuffle_mul_indices(network net, int layer_idx) {
     if (layer_idx > 0 && layer_idx < net.num_layers) {
         for (int i = 0; i < net.layers[ layer_idx ].num_neurons; i++){
-            fisher_yates(net.layers[ layer_idx ].neurons[ i ].mul_indices, net.layers[ layer_idx ].neurons[ i ].num_weights);
+            fisher_yates(&net.layers[ layer_idx ].mul_indices[ i * net.layers[ layer_idx ].num_weights ], net.layers[ layer_idx ].num_weights);
         }
     }
     return net;
 }
 
+network shuffle_neuron_order(network net, int layer_idx) {
+    if (layer_idx > 0 && layer_idx < net.num_layers) {
+        fisher_yates(net.layers[ layer_idx ].neuron_order, net.layers[ layer_idx ].num_neurons);
+    }
+    return net;
+}
+
+network shuffle_mac_order(network net, int layer_idx) {
+    if (layer_idx > 0 && layer_idx < net.num_layers) {
+        fisher_yates(net.layers[ layer_idx ].mac_order, net.layers[ layer_idx ].num_neurons * net.layers[ layer_idx ].num_weights);
+    }
+    return net;
+}
+
 network shuffle_mul_indices_deranged(network net, int layer_idx) {
     if (layer_idx > 0 && layer_idx < net.num_layers) {
         for (int i = 0; i < net.layers[ layer_idx ].num_neurons; i++){
-            fisher_yates_deranged(net.layers[ layer_idx ].neurons[ i ].mul_indices, net.layers[ layer_idx ].neurons[ i ].num_weights);
+            fisher_yates_deranged(&net.layers[ layer_idx ].mul_indices[ i * net.layers[ layer_idx ].num_weights ], net.layers[ layer_idx ].num_weights);
         }
     }
     return net;
 }
 
-network forward(network net){
-    volatile int curr_layer_idx, curr_neuron_idx, prev_layer_neuron_idx;
-    // for each layer
-    for (curr_layer_idx=1; curr_layer_idx < net.num_layers; curr_layer_idx++){
-        
-        int prev_layer_idx = curr_layer_idx - 1;
-        // for each neuron in this layer
-        for (curr_neuron_idx=0; curr_neuron_idx < net.layers[ curr_layer_idx ].num_neurons; curr_neuron_idx++){   
-            net.layers[ curr_layer_idx ].neurons[ curr_neuron_idx ].z = net.layers[ curr_layer_idx ].neurons[ curr_neuron_idx ].bias;
-
-            // for all neurons on the previous layer
-            for (prev_layer_neuron_idx = 0; prev_layer_neuron_idx <net.layers[ prev_layer_idx ].num_neurons; prev_layer_neuron_idx++){
-                net.layers[ curr_layer_idx ].neurons[ curr_neuron_idx ].z =
-                    net.layers[ curr_layer_idx ].neurons[ curr_neuron_idx ].z
-                    +
-                    (
-                        (net.layers[ curr_layer_idx ].neurons[ curr_neuron_idx ].weights[ prev_layer_neuron_idx ])
-                        *
-                        (net.layers[ prev_layer_idx ].neurons[ prev_layer_neuron_idx ].a)
-                    );
-                // We are looking for THIS MULTIPLICATION
-            }
-            //get a values
-            net.layers[curr_layer_idx].neurons[ curr_neuron_idx ].a = net.layers[curr_layer_idx].neurons[ curr_neuron_idx ].z;
-            //apply relu
-            if(curr_layer_idx < net.num_layers-1){
-                if((net.layers[curr_layer_idx].neurons[ curr_neuron_idx ].z) < 0)
-                {
-                    net.layers[curr_layer_idx].neurons[ curr_neuron_idx ].a = 0;
-                }
+/*
+* Permutation pool - a ring of PERM_POOL_DEPTH pre-shuffled multiplication orders, each slot covering every weighted
+* layer. perm_pool_refill() reshuffles the used slots while the target is idle (after the response is sent), so the
+* per-trace setup in shuffle_mul_indices_pooled() is just pointing the layers at the next slot. set_masked_shuffle()
+* switches both the refills and the in-place fallback to fisher_yates_masked(); slots already shuffled are used first.
+* -DPERM_POOL_DEPTH=0 drops the pool and shuffles in place every trace, as before.
+*/
+#if PERM_POOL_DEPTH > 0
+static struct {
+    int slots[PERM_POOL_DEPTH][NET_TOTAL_WEIGHTS];
+    int head;   // next slot to hand out
+    int ready;  // shuffled slots not handed out yet
+} perm_pool;
+#endif
+
+static void perm_pool_init(network net) {
+#if PERM_POOL_DEPTH > 0
+    for (int s = 0; s < PERM_POOL_DEPTH; s++){
+        memcpy(perm_pool.slots[s], net_arena.mul_indices, sizeof(net_arena.mul_indices));
+    }
+    perm_pool.head = 0;
+    perm_pool.ready = 0;
+    perm_pool_refill(net, PERM_POOL_DEPTH);
+#endif
+}
+
+/*
+* Reshuffles up to max_slots used slots, returns how many it did. Fisher-Yates over a slot's previous permutation
+* is as uniform as over the identity, so the slots are never reset.
+*/
+int perm_pool_refill(network net, int max_slots) {
+    int filled = 0;
+#if PERM_POOL_DEPTH > 0
+    while (filled < max_slots && perm_pool.ready < PERM_POOL_DEPTH){
+        int *slot = perm_pool.slots[(perm_pool.head + perm_pool.ready) % PERM_POOL_DEPTH];
+        for (int i = 1; i < net.num_layers; i++){
+            int *layer_slot = &slot[net_arena.weight_offset[i]];
+            for (int j = 0; j < net.layers[i].num_neurons; j++){
+                if (net_masked_shuffle)
+                    fisher_yates_masked(&layer_slot[j * net.layers[i].num_weights], net.layers[i].num_weights);
                 else
-                {
-                    net.layers[curr_layer_idx].neurons[ curr_neuron_idx ].a = net.layers[curr_layer_idx].neurons[ curr_neuron_idx ].z;
-                }
+                    fisher_yates(&layer_slot[j * net.layers[i].num_weights], net.layers[i].num_weights);
             }
-            //apply sigmoid to the last layer
-            else{
-                net.layers[curr_layer_idx].neurons[ curr_neuron_idx ].a = 1/(1+exp(-net.layers[curr_layer_idx].neurons[ curr_neuron_idx ].z));
+        }
+        perm_pool.ready++;
+        filled++;
+    }
+#endif
+    return filled;
+}
+
+/*
+* Shuffles every weighted layer for the next trace - from the pool if a slot is ready, in place otherwise
+* (e.g. in the middle of a long 'q' batch).
+*/
+network shuffle_mul_indices_pooled(network net) {
+#if PERM_POOL_DEPTH > 0
+    if (perm_pool.ready > 0){
+        int *slot = perm_pool.slots[perm_pool.head];
+        perm_pool.head = (perm_pool.head + 1) % PERM_POOL_DEPTH;
+        perm_pool.ready--;
+        for (int i = 1; i < net.num_layers; i++){
+            net.layers[i].mul_indices = &slot[net_arena.weight_offset[i]];
+        }
+        return net;
+    }
+#endif
+    for (int i = 1; i < net.num_layers; i++){
+        net = net_masked_shuffle ? shuffle_mul_indices_masked(net, i) : shuffle_mul_indices(net, i);
+    }
+    return net;
+}
+
+/*
+* sigmoid(x) in Q31 for x = 0 .. 16 in steps of 1/16 (257 entries), the negative half by symmetry.
+* Generated with round(2^31 / (1 + exp(-i / 16))).
+*/
+static const uint32_t sigmoid_lut[257] = {
+    1073741824u, 1107285338u, 1140763443u, 1174111241u, 1207264843u, 1240161854u, 1272741832u, 1304946721u,
+    1336721235u, 1368013214u, 1398773921u, 1428958294u, 1458525151u, 1487437333u, 1515661806u, 1543169708u,
+    1569936343u, 1595941146u, 1621167590u, 1645603068u, 1669238741u, 1692069358u, 1714093053u, 1735311128u,
+    1755727819u, 1775350059u, 1794187234u, 1812250933u, 1829554711u, 1846113847u, 1861945116u, 1877066570u,
+    1891497322u, 1905257357u, 1918367342u, 1930848455u, 1942722231u, 1954010417u, 1964734840u, 1974917298u,
+    1984579447u, 1993742718u, 2002428233u, 2010656740u, 2018448549u, 2025823491u, 2032800871u, 2039399438u,
+    2045637361u, 2051532210u, 2057100941u, 2062359889u, 2067324768u, 2072010665u, 2076432050u, 2080602781u,
+    2084536112u, 2088244705u, 2091740648u, 2095035461u, 2098140122u, 2101065074u, 2103820252u, 2106415092u,
+    2108858556u, 2111159148u, 2113324932u, 2115363549u, 2117282239u, 2119087855u, 2120786881u, 2122385453u,
+    2123889368u, 2125304109u, 2126634854u, 2127886491u, 2129063638u, 2130170653u, 2131211646u, 2132190496u,
+    2133110860u, 2133976186u, 2134789724u, 2135554538u, 2136273513u, 2136949369u, 2137584667u, 2138181818u,
+    2138743094u, 2139270632u, 2139766445u, 2140232428u, 2140670363u, 2141081929u, 2141468703u, 2141832171u,
+    2142173730u, 2142494694u, 2142796300u, 2143079710u, 2143346017u, 2143596249u, 2143831374u, 2144052301u,
+    2144259884u, 2144454926u, 2144638184u, 2144810367u, 2144972144u, 2145124141u, 2145266949u, 2145401122u,
+    2145527180u, 2145645615u, 2145756887u, 2145861427u, 2145959642u, 2146051916u, 2146138606u, 2146220050u,
+    2146296565u, 2146368449u, 2146435983u, 2146499429u, 2146559034u, 2146615031u, 2146667637u, 2146717059u,
+    2146763489u, 2146807108u, 2146848085u, 2146886581u, 2146922746u, 2146956721u, 2146988639u, 2147018623u,
+    2147046792u, 2147073255u, 2147098115u, 2147121469u, 2147143409u, 2147164020u, 2147183382u, 2147201572u,
+    2147218660u, 2147234713u, 2147249794u, 2147263961u, 2147277270u, 2147289772u, 2147301518u, 2147312552u,
+    2147322917u, 2147332654u, 2147341802u, 2147350396u, 2147358468u, 2147366052u, 2147373177u, 2147379869u,
+    2147386157u, 2147392063u, 2147397612u, 2147402824u, 2147407721u, 2147412321u, 2147416642u, 2147420702u,
+    2147424516u, 2147428098u, 2147431464u, 2147434625u, 2147437595u, 2147440385u, 2147443007u, 2147445469u,
+    2147447782u, 2147449955u, 2147451996u, 2147453914u, 2147455715u, 2147457408u, 2147458998u, 2147460491u,
+    2147461894u, 2147463212u, 2147464450u, 2147465613u, 2147466706u, 2147467732u, 2147468697u, 2147469603u,
+    2147470453u, 2147471253u, 2147472004u, 2147472709u, 2147473372u, 2147473995u, 2147474580u, 2147475129u,
+    2147475645u, 2147476130u, 2147476585u, 2147477013u, 2147477415u, 2147477793u, 2147478148u, 2147478481u,
+    2147478794u, 2147479088u, 2147479364u, 2147479624u, 2147479868u, 2147480097u, 2147480312u, 2147480514u,
+    2147480704u, 2147480882u, 2147481050u, 2147481207u, 2147481355u, 2147481494u, 2147481625u, 2147481747u,
+    2147481862u, 2147481970u, 2147482072u, 2147482168u, 2147482257u, 2147482342u, 2147482421u, 2147482495u,
+    2147482565u, 2147482631u, 2147482692u, 2147482750u, 2147482804u, 2147482856u, 2147482904u, 2147482949u,
+    2147482991u, 2147483031u, 2147483068u, 2147483103u, 2147483136u, 2147483167u, 2147483197u, 2147483224u,
+    2147483250u, 2147483274u, 2147483296u, 2147483318u, 2147483338u, 2147483356u, 2147483374u, 2147483391u,
+    2147483406u
+};
+
+/*
+* Output layer sigmoid without libm and without float arithmetic: |z| goes to fixed point straight from its bits,
+* the table is interpolated in integers and the Q31 result is packed back into a float with CLZ. Saturation at 16,
+* the sign and the shift counts are masks, not branches, so nothing here branches on z and no libgcc soft-float
+* routine (with their early exits on zero and denormal operands) runs. The table index does depend on z: its timing is
+* flat on the cacheless STM32F3, but which word is read is as visible in the power trace as any other
+* secret-indexed load. Within 5e-5 of 1 / (1 + exp(-z)) everywhere (the interpolation error). FAST_SIGMOID picks it
+* at build time, set_fast_sigmoid() at run time; the fixed point modes keep qsigmoid().
+*/
+static int net_fast_sigmoid = FAST_SIGMOID;
+
+void set_fast_sigmoid(int enabled) {
+    net_fast_sigmoid = enabled ? 1 : 0;
+}
+
+int get_fast_sigmoid(void) {
+    return net_fast_sigmoid;
+}
+
+float fast_sigmoid(float z) {
+    const uint32_t saturated = 0x41800000u;                 // 16.0f
+    const int32_t last = (256 << 16) - 1;                   // largest t, just below 16
+    uint32_t bits;
+    memcpy(&bits, &z, sizeof(bits));
+    const uint32_t negative = bits >> 31;
+    int32_t over = (int32_t)((bits & 0x7FFFFFFFu) - saturated);
+    bits = saturated + (uint32_t)(over & (over >> 31));     // min(|z|, 16), NaN saturates too
+
+    // t = |z| in Q20, i.e. the table position in Q16: mantissa << 1 >> (131 - exponent), the count capped at 31
+    const uint32_t mantissa = (bits & 0x7FFFFFu) | 0x800000u;
+    int32_t shift = 131 - (int32_t)(bits >> 23) - 31;
+    shift = 31 + (shift & (shift >> 31));
+    int32_t t = (int32_t)((mantissa << 1) >> shift);
+    int32_t past = t - last;
+    t = last + (past & (past >> 31));
+
+    const uint32_t idx = (uint32_t)t >> 16, frac = (uint32_t)t & 0xFFFFu;
+    const uint64_t step = (uint64_t)(sigmoid_lut[idx + 1] - sigmoid_lut[idx]) * frac;
+    const uint32_t y = sigmoid_lut[idx] + (uint32_t)(step >> 16);
+    // sigmoid(-z) = 1 - sigmoid(z), in [240, 2^31) either way
+    const uint32_t q = y + negative * ((1u << 31) - 2u * y);
+
+    // q * 2^-31 as a float: normalise with CLZ, truncate to 24 bits
+    const uint32_t lz = (uint32_t)__builtin_clz(q);
+    const uint32_t out = ((127u - lz) << 23) | (((q << lz) >> 8) & 0x7FFFFFu);
+    float result;
+    memcpy(&result, &out, sizeof(result));
+    return result;
+}
+
+// 'g' 0 is expf() in every mode, so every mode measures the table against the same baseline
+static inline __attribute__((always_inline)) float output_sigmoidf(float z){
+    return net_fast_sigmoid ? fast_sigmoid(z) : 1.0f / (1.0f + expf(-z));
+}
+
+/*
+* Activations at the end (AAE): one pass over the layer's z vector after all of its sums - ReLU on the hidden layers,
+* sigmoid on the output layer. The ReLU clears the float with a mask built from its sign bit, like the integer ReLU in
+* qnetwork.c, so it has no data-dependent branch. Used by the MAC kernels, and by the other float modes when
+* set_deferred_activation() is on: their activation leakage then sits after the MAC window instead of between neurons.
+*/
+static int net_deferred_activation = DEFERRED_ACTIVATION;
+
+void set_deferred_activation(int enabled) {
+    net_deferred_activation = enabled ? 1 : 0;
+}
+
+int get_deferred_activation(void) {
+    return net_deferred_activation;
+}
+
+static inline __attribute__((always_inline)) void activate_layer(layer curr, const int num_neurons, const int is_output_layer){
+    if (!is_output_layer){
+        for (int j = 0; j < num_neurons; j++){
+            uint32_t bits;
+            memcpy(&bits, &curr.z[j], sizeof(bits));
+            bits &= ~(uint32_t)((int32_t)bits >> 31);
+            memcpy(&curr.a[j], &bits, sizeof(bits));
+        }
+    }
+    else{
+        for (int j = 0; j < num_neurons; j++){
+            curr.a[j] = output_sigmoidf(curr.z[j]);
+        }
+    }
+}
+
+/*
+* One layer of forward(). It is instantiated once per layer from NET_CONFIG_LAYERS, so num_weights and num_neurons
+* are compile-time constants and every loop below has a fixed trip count. at_end defers the activations to
+* activate_layer() - also a constant, so the per-neuron activation compiles away.
+*/
+static inline __attribute__((always_inline)) void forward_layer(layer curr, layer prev, const int layer_idx, const int num_weights, const int num_neurons, const int is_output_layer, const int at_end){
+    volatile int curr_neuron_idx, prev_layer_neuron_idx;
+    MARK_LAYER(layer_idx);
+    // for each neuron in this layer
+    for (curr_neuron_idx=0; curr_neuron_idx < num_neurons; curr_neuron_idx++){
+        MARK_NEURON(layer_idx, curr_neuron_idx);
+        const float *weights = &curr.weights[ curr_neuron_idx * num_weights ];
+        curr.z[ curr_neuron_idx ] = curr.bias[ curr_neuron_idx ];
+
+        // for all neurons on the previous layer
+        for (prev_layer_neuron_idx = 0; prev_layer_neuron_idx < num_weights; prev_layer_neuron_idx++){
+            curr.z[ curr_neuron_idx ] =
+                curr.z[ curr_neuron_idx ]
+                +
+                (
+                    (weights[ prev_layer_neuron_idx ])
+                    *
+                    (prev.a[ prev_layer_neuron_idx ])
+                );
+            // We are looking for THIS MULTIPLICATION
+        }
+        if (at_end) continue;
+        //get a values
+        curr.a[ curr_neuron_idx ] = curr.z[ curr_neuron_idx ];
+        //apply relu
+        if(!is_output_layer){
+            if((curr.z[ curr_neuron_idx ]) < 0)
+            {
+                curr.a[ curr_neuron_idx ] = 0;
+            }
+            else
+            {
+                curr.a[ curr_neuron_idx ] = curr.z[ curr_neuron_idx ];
             }
         }
+        //apply sigmoid to the last layer
+        else{
+            curr.a[ curr_neuron_idx ] = output_sigmoidf(curr.z[ curr_neuron_idx ]);
+        }
+    }
+    if (at_end) activate_layer(curr, num_neurons, is_output_layer);
+}
+
+network forward(network net){
+    // for each layer - unrolled at compile time, once with the activations per neuron and once at the end of each layer
+    if (net_deferred_activation){
+        #define X(layer_idx, prev_layer_idx, num_weights, num_neurons) \
+            forward_layer(net.layers[ layer_idx ], net.layers[ prev_layer_idx ], layer_idx, num_weights, num_neurons, layer_idx == NET_NUM_LAYERS - 1, 1);
+        NET_CONFIG_LAYERS(X)
+        #undef X
+    }
+    else{
+        #define X(layer_idx, prev_layer_idx, num_weights, num_neurons) \
+            forward_layer(net.layers[ layer_idx ], net.layers[ prev_layer_idx ], layer_idx, num_weights, num_neurons, layer_idx == NET_NUM_LAYERS - 1, 0);
+        NET_CONFIG_LAYERS(X)
+        #undef X
     }
     return net;
 }
 
 
-static uint32_t jitter_state = 0xA5A5A5A5u; 
+static rng_t jitter_rng = {{0xA5A5A5A5u, 0x3C6EF372u, 0xDAA66D2Bu, 0x78DDE6E4u}};
 
+// Jitter has its own stream: handle() reseeds it per trace without touching rng_global
 void jitter_seed(uint32_t seed) {
-    if (seed != 0) {
-        jitter_state = seed;
-    } else {
-        jitter_state = 0xA5A5A5A5u;
-    }
+    rng_seed_stream(&jitter_rng, seed != 0 ? seed : 0xA5A5A5A5u);
 }
 
 
 static inline uint32_t jitter_next_u32(void) {
-    uint32_t x = jitter_state;
-    x ^= x << 13;
-    x ^= x >> 17;
-    x ^= x << 5;
-    jitter_state = x;
-    return x;
+    return rng_next(&jitter_rng);
 }
 
 
+// all ones normally, 0 lets the benchmark time forward_shuffled() without the delay loops but with the same draws
+static uint32_t jitter_mask = 0xFFFFFFFFu;
+
+void jitter_enable(int enabled) {
+    jitter_mask = enabled ? 0xFFFFFFFFu : 0u;
+}
+
 static inline void delay_jitter_cycles(int J) {
-    int r = (int)(jitter_next_u32() & (uint32_t)J);
+    int r = (int)(jitter_next_u32() & (uint32_t)J & jitter_mask);
     for (volatile int d = 0; d < r; d++) {
         __asm__ __volatile__("nop");
     }
 }
 
 
-network forward_shuffled(network net) {
+/*
+* One layer of forward_shuffled(), instantiated per layer like forward_layer().
+*/
+static inline __attribute__((always_inline)) void forward_shuffled_layer(layer curr, layer prev, const int layer_idx, const int num_weights, const int num_neurons, const int is_output_layer, const int at_end){
 
     const int J_layer = 7;
     const int J_mul   = 15; 
 
-    volatile int curr_layer_idx, curr_neuron_idx, prev_layer_neuron_idx;
-    // for each layer
-    for (curr_layer_idx=1; curr_layer_idx < net.num_layers; curr_layer_idx++){
-        
-        delay_jitter_cycles(J_layer);
+    volatile int curr_neuron_idx, prev_layer_neuron_idx;
 
-        int prev_layer_idx = curr_layer_idx - 1;
-        // for each neuron in this layer
-        for (curr_neuron_idx=0; curr_neuron_idx < net.layers[ curr_layer_idx ].num_neurons; curr_neuron_idx++){   
-            net.layers[ curr_layer_idx ].neurons[ curr_neuron_idx ].z = net.layers[ curr_layer_idx ].neurons[ curr_neuron_idx ].bias;
-
-            // for all neurons on the previous layer
-            for (prev_layer_neuron_idx = 0; prev_layer_neuron_idx < net.layers[ prev_layer_idx ].num_neurons; prev_layer_neuron_idx++){
-
-                delay_jitter_cycles(J_mul);
-
-                int mul_index = net.layers[ curr_layer_idx ].neurons[ curr_neuron_idx ].mul_indices[ prev_layer_neuron_idx ]; // CHANGE from forward - added this line
-
-                net.layers[ curr_layer_idx ].neurons[ curr_neuron_idx ].z =
-                    net.layers[ curr_layer_idx ].neurons[ curr_neuron_idx ].z
-                    +
-                    (
-                        (net.layers[ curr_layer_idx ].neurons[ curr_neuron_idx ].weights[ mul_index ]) // CHANGE from forward - .weights[ prev_layer_neuron_idx ] -> .weights[ mul_index ]
-                        *
-                        (net.layers[ prev_layer_idx ].neurons[ mul_index ].a) // CHANGE from forward - .neurons[ prev_layer_neuron_idx ].a -> .neurons[ mul_index ].a
-                    );
-                // We are looking for THIS MULTIPLICATION
+    MARK_LAYER(layer_idx);
+    delay_jitter_cycles(J_layer);
+
+    // for each neuron in this layer
+    for (curr_neuron_idx=0; curr_neuron_idx < num_neurons; curr_neuron_idx++){
+        MARK_NEURON(layer_idx, curr_neuron_idx);
+        const float *weights = &curr.weights[ curr_neuron_idx * num_weights ];
+        const int *mul_indices = &curr.mul_indices[ curr_neuron_idx * num_weights ];
+        curr.z[ curr_neuron_idx ] = curr.bias[ curr_neuron_idx ];
+
+        // for all neurons on the previous layer
+        for (prev_layer_neuron_idx = 0; prev_layer_neuron_idx < num_weights; prev_layer_neuron_idx++){
+
+            delay_jitter_cycles(J_mul);
+
+            int mul_index = mul_indices[ prev_layer_neuron_idx ]; // CHANGE from forward - added this line
+
+            curr.z[ curr_neuron_idx ] =
+                curr.z[ curr_neuron_idx ]
+                +
+                (
+                    (weights[ mul_index ]) // CHANGE from forward - weights[ prev_layer_neuron_idx ] -> weights[ mul_index ]
+                    *
+                    (prev.a[ mul_index ]) // CHANGE from forward - .a[ prev_layer_neuron_idx ] -> .a[ mul_index ]
+                );
+            // We are looking for THIS MULTIPLICATION
+        }
+        if (at_end) continue;
+        //get a values
+        curr.a[ curr_neuron_idx ] = curr.z[ curr_neuron_idx ];
+        //apply relu
+        if(!is_output_layer){
+            if((curr.z[ curr_neuron_idx ]) < 0)
+            {
+                curr.a[ curr_neuron_idx ] = 0;
             }
-            //get a values
-            net.layers[curr_layer_idx].neurons[ curr_neuron_idx ].a = net.layers[curr_layer_idx].neurons[ curr_neuron_idx ].z;
-            //apply relu
-            if(curr_layer_idx < net.num_layers - 1){
-                if((net.layers[curr_layer_idx].neurons[ curr_neuron_idx ].z) < 0)
-                {
-                    net.layers[curr_layer_idx].neurons[ curr_neuron_idx ].a = 0;
-                }
-                else
-                {
-                    net.layers[curr_layer_idx].neurons[ curr_neuron_idx ].a = net.layers[curr_layer_idx].neurons[ curr_neuron_idx ].z;
-                }
+            else
+            {
+                curr.a[ curr_neuron_idx ] = curr.z[ curr_neuron_idx ];
+            }
+        }
+        //apply sigmoid to the last layer
+        else{
+            //for (int i = 0; i < 15; i++) a = a * a;
+            curr.a[ curr_neuron_idx ] = output_sigmoidf(curr.z[ curr_neuron_idx ]);
+        }
+    }
+    if (at_end) activate_layer(curr, num_neurons, is_output_layer);
+}
+
+network forward_shuffled(network net) {
+    // for each layer - unrolled at compile time, once with the activations per neuron and once at the end of each layer
+    if (net_deferred_activation){
+        #define X(layer_idx, prev_layer_idx, num_weights, num_neurons) \
+            forward_shuffled_layer(net.layers[ layer_idx ], net.layers[ prev_layer_idx ], layer_idx, num_weights, num_neurons, layer_idx == NET_NUM_LAYERS - 1, 1);
+        NET_CONFIG_LAYERS(X)
+        #undef X
+    }
+    else{
+        #define X(layer_idx, prev_layer_idx, num_weights, num_neurons) \
+            forward_shuffled_layer(net.layers[ layer_idx ], net.layers[ prev_layer_idx ], layer_idx, num_weights, num_neurons, layer_idx == NET_NUM_LAYERS - 1, 0);
+        NET_CONFIG_LAYERS(X)
+        #undef X
+    }
+    return net;
+}
+
+/*
+* forward_shuffled_layer() with the neurons also evaluated in the random order curr.neuron_order, so only the layer
+* boundaries are left at a fixed time. Same jitter as scmd 1 - only the shuffle granularity differs.
+*/
+static inline __attribute__((always_inline)) void forward_neuron_shuffled_layer(layer curr, layer prev, const int layer_idx, const int num_weights, const int num_neurons, const int is_output_layer, const int at_end){
+
+    const int J_layer = 7;
+    const int J_mul   = 15;
+
+    volatile int order_idx, prev_layer_neuron_idx;
+
+    MARK_LAYER(layer_idx);
+    delay_jitter_cycles(J_layer);
+
+    // for each neuron in this layer, in random order
+    for (order_idx = 0; order_idx < num_neurons; order_idx++){
+        const int curr_neuron_idx = curr.neuron_order[ order_idx ];
+        MARK_NEURON(layer_idx, curr_neuron_idx);
+        const float *weights = &curr.weights[ curr_neuron_idx * num_weights ];
+        const int *mul_indices = &curr.mul_indices[ curr_neuron_idx * num_weights ];
+        curr.z[ curr_neuron_idx ] = curr.bias[ curr_neuron_idx ];
+
+        // for all neurons on the previous layer
+        for (prev_layer_neuron_idx = 0; prev_layer_neuron_idx < num_weights; prev_layer_neuron_idx++){
+            delay_jitter_cycles(J_mul);
+            int mul_index = mul_indices[ prev_layer_neuron_idx ];
+            curr.z[ curr_neuron_idx ] = curr.z[ curr_neuron_idx ] + (weights[ mul_index ] * prev.a[ mul_index ]);
+        }
+        if (at_end) continue;
+        //apply relu / sigmoid
+        if(!is_output_layer){
+            if((curr.z[ curr_neuron_idx ]) < 0)
+            {
+                curr.a[ curr_neuron_idx ] = 0;
             }
-            //apply sigmoid to the last layer
-            else{
-                //for (int i = 0; i < 15; i++) a = a * a;
-                net.layers[curr_layer_idx].neurons[ curr_neuron_idx ].a = 1/(1+exp(-net.layers[curr_layer_idx].neurons[ curr_neuron_idx ].z));
+            else
+            {
+                curr.a[ curr_neuron_idx ] = curr.z[ curr_neuron_idx ];
             }
         }
+        else{
+            curr.a[ curr_neuron_idx ] = output_sigmoidf(curr.z[ curr_neuron_idx ]);
+        }
+    }
+    if (at_end) activate_layer(curr, num_neurons, is_output_layer);
+}
+
+/*
+* The layer's whole [num_neurons][num_weights] MAC grid in the random order curr.mac_order, so consecutive
+* multiplications belong to different neurons and neither the neuron nor the input of a MAC follows from its time.
+* mac_order holds flat indices into the row-major weights: the weight is one load, neuron and input come from a
+* division by the compile-time fan-in (a multiply and a shift), so the n*m! permutation space costs no second
+* indirection. The activations are always at the end (activate_layer()). Same jitter as scmd 1.
+*/
+static inline __attribute__((always_inline)) void forward_grid_shuffled_layer(layer curr, layer prev, const int layer_idx, const int num_weights, const int num_neurons, const int is_output_layer){
+
+    const int J_layer = 7;
+    const int J_mul   = 15;
+
+    volatile int mac_idx;
+
+    MARK_LAYER(layer_idx);
+    delay_jitter_cycles(J_layer);
+
+    for (int j = 0; j < num_neurons; j++){
+        curr.z[j] = curr.bias[j];
+    }
+    // every (neuron, input) pair of the layer, in random order
+    for (mac_idx = 0; mac_idx < num_neurons * num_weights; mac_idx++){
+        delay_jitter_cycles(J_mul);
+        const unsigned int flat = (unsigned int)curr.mac_order[ mac_idx ];
+        const unsigned int j = flat / (unsigned int)num_weights;
+        const unsigned int k = flat - j * (unsigned int)num_weights;
+        curr.z[ j ] = curr.z[ j ] + (curr.weights[ flat ] * prev.a[ k ]);
+    }
+    activate_layer(curr, num_neurons, is_output_layer);
+}
+
+network forward_neuron_shuffled(network net) {
+    if (net_deferred_activation){
+        #define X(layer_idx, prev_layer_idx, num_weights, num_neurons) \
+            forward_neuron_shuffled_layer(net.layers[ layer_idx ], net.layers[ prev_layer_idx ], layer_idx, num_weights, num_neurons, layer_idx == NET_NUM_LAYERS - 1, 1);
+        NET_CONFIG_LAYERS(X)
+        #undef X
+    }
+    else{
+        #define X(layer_idx, prev_layer_idx, num_weights, num_neurons) \
+            forward_neuron_shuffled_layer(net.layers[ layer_idx ], net.layers[ prev_layer_idx ], layer_idx, num_weights, num_neurons, layer_idx == NET_NUM_LAYERS - 1, 0);
+        NET_CONFIG_LAYERS(X)
+        #undef X
     }
     return net;
 }
 
+network forward_grid_shuffled(network net) {
+    #define X(layer_idx, prev_layer_idx, num_weights, num_neurons) \
+        forward_grid_shuffled_layer(net.layers[ layer_idx ], net.layers[ prev_layer_idx ], layer_idx, num_weights, num_neurons, layer_idx == NET_NUM_LAYERS - 1);
+    NET_CONFIG_LAYERS(X)
+    #undef X
+    return net;
+}
+
 /* =========================
    Masked forward variants (GPT TRASH BELOW DONT LOOK !!! WILL BE DELETED LATER!!! NOW I AM NOT USING IT)
    ========================= */
 
-#include <stdlib.h>  // rand()
 #include <math.h>    // expf
 
-/* допоміжна функція для випадкових масок */
-static inline float nn_rand_uniformf(float lo, float hi) {
-    return lo + (hi - lo) * (rand() / (float)RAND_MAX);
-}
+/* маски поточного шару - rng_fill_uniformf() генерує їх одним викликом на початку шару */
+static float mask_pool[NET_TOTAL_WEIGHTS];
 
 /* -------- ВАРІАНТ 1: маска на нейрон (дешево) -------- */
 network forward_masked_neuron(network net, float mask_scale) {
     volatile int curr_layer_idx, curr_neuron_idx, prev_layer_neuron_idx;
 
     for (curr_layer_idx = 1; curr_layer_idx < net.num_layers; curr_layer_idx++) {
+        MARK_LAYER(curr_layer_idx);
         int prev_layer_idx = curr_layer_idx - 1;
+        rng_fill_uniformf(mask_pool, net.layers[ curr_layer_idx ].num_neurons, -mask_scale, mask_scale);
 
         for (curr_neuron_idx = 0; curr_neuron_idx < net.layers[curr_layer_idx].num_neurons; curr_neuron_idx++) {
+            MARK_NEURON(curr_layer_idx, curr_neuron_idx);
 
             /* одна маска R на нейрон — додаємо до bias і знімаємо після суми */
-            float R = nn_rand_uniformf(-mask_scale, mask_scale);
-            net.layers[curr_layer_idx].neurons[curr_neuron_idx].z =
-                net.layers[curr_layer_idx].neurons[curr_neuron_idx].bias + R;
+            float R = mask_pool[ curr_neuron_idx ];
+            net.layers[ curr_layer_idx ].z[ curr_neuron_idx ] =
+                net.layers[ curr_layer_idx ].bias[ curr_neuron_idx ] + R;
 
             for (prev_layer_neuron_idx = 0;
                  prev_layer_neuron_idx < net.layers[prev_layer_idx].num_neurons;
                  prev_layer_neuron_idx++) {
 
-                net.layers[curr_layer_idx].neurons[curr_neuron_idx].z +=
-                    net.layers[curr_layer_idx].neurons[curr_neuron_idx]
-                        .weights[prev_layer_neuron_idx] *
-                    net.layers[prev_layer_idx].neurons[prev_layer_neuron_idx].a;
+                net.layers[ curr_layer_idx ].z[ curr_neuron_idx ] +=
+                    net.layers[ curr_layer_idx ].weights[ curr_neuron_idx * net.layers[ curr_layer_idx ].num_weights + prev_layer_neuron_idx ] *
+                    net.layers[ prev_layer_idx ].a[ prev_layer_neuron_idx ];
                 /* <-- чутливе множення відбувається тут */
             }
 
             /* знімаємо маску — функціонально вихід такий самий як у forward() */
-            net.layers[curr_layer_idx].neurons[curr_neuron_idx].z -= R;
+            net.layers[ curr_layer_idx ].z[ curr_neuron_idx ] -= R;
+
+            if (net_deferred_activation) continue;
 
             /* активації без змін */
-            net.layers[curr_layer_idx].neurons[curr_neuron_idx].a =
-                net.layers[curr_layer_idx].neurons[curr_neuron_idx].z;
+            net.layers[ curr_layer_idx ].a[ curr_neuron_idx ] =
+                net.layers[ curr_layer_idx ].z[ curr_neuron_idx ];
 
             if (curr_layer_idx < net.num_layers - 1) {
-                if (net.layers[curr_layer_idx].neurons[curr_neuron_idx].z < 0.0f) {
-                    net.layers[curr_layer_idx].neurons[curr_neuron_idx].a = 0.0f;
+                if (net.layers[ curr_layer_idx ].z[ curr_neuron_idx ] < 0.0f) {
+                    net.layers[ curr_layer_idx ].a[ curr_neuron_idx ] = 0.0f;
                 } else {
-                    net.layers[curr_layer_idx].neurons[curr_neuron_idx].a =
-                        net.layers[curr_layer_idx].neurons[curr_neuron_idx].z;
+                    net.layers[ curr_layer_idx ].a[ curr_neuron_idx ] =
+                        net.layers[ curr_layer_idx ].z[ curr_neuron_idx ];
                 }
             } else {
-                net.layers[curr_layer_idx].neurons[curr_neuron_idx].a =
-                    1.0f / (1.0f + expf(-net.layers[curr_layer_idx].neurons[curr_neuron_idx].z));
+                net.layers[ curr_layer_idx ].a[ curr_neuron_idx ] =
+                    output_sigmoidf(net.layers[ curr_layer_idx ].z[ curr_neuron_idx ]);
             }
         }
+        if (net_deferred_activation) {
+            activate_layer(net.layers[ curr_layer_idx ], net.layers[ curr_layer_idx ].num_neurons, curr_layer_idx == net.num_layers - 1);
+        }
     }
     return net;
 }
@@ -432,44 +813,52 @@ network forward_masked_mul(network net, float mask_scale) {
     volatile int curr_layer_idx, curr_neuron_idx, prev_layer_neuron_idx;
 
     for (curr_layer_idx = 1; curr_layer_idx < net.num_layers; curr_layer_idx++) {
+        MARK_LAYER(curr_layer_idx);
         int prev_layer_idx = curr_layer_idx - 1;
+        rng_fill_uniformf(mask_pool, net.layers[ curr_layer_idx ].num_neurons * net.layers[ curr_layer_idx ].num_weights,
+                          -mask_scale, mask_scale);
 
         for (curr_neuron_idx = 0; curr_neuron_idx < net.layers[curr_layer_idx].num_neurons; curr_neuron_idx++) {
+            MARK_NEURON(curr_layer_idx, curr_neuron_idx);
 
-            float acc1 = net.layers[curr_layer_idx].neurons[curr_neuron_idx].bias; /* сума w*(a+r) */
+            float acc1 = net.layers[ curr_layer_idx ].bias[ curr_neuron_idx ]; /* сума w*(a+r) */
             float acc2 = 0.0f;                                                    /* сума w*r     */
 
             for (prev_layer_neuron_idx = 0;
                  prev_layer_neuron_idx < net.layers[prev_layer_idx].num_neurons;
                  prev_layer_neuron_idx++) {
 
-                float w = net.layers[curr_layer_idx].neurons[curr_neuron_idx]
-                              .weights[prev_layer_neuron_idx];
-                float a = net.layers[prev_layer_idx].neurons[prev_layer_neuron_idx].a;
-                float r = nn_rand_uniformf(-mask_scale, mask_scale);
+                float w = net.layers[ curr_layer_idx ].weights[ curr_neuron_idx * net.layers[ curr_layer_idx ].num_weights + prev_layer_neuron_idx ];
+                float a = net.layers[ prev_layer_idx ].a[ prev_layer_neuron_idx ];
+                float r = mask_pool[ curr_neuron_idx * net.layers[ curr_layer_idx ].num_weights + prev_layer_neuron_idx ];
 
                 acc1 += w * (a + r);  /* множення на замаскований вхід */
                 acc2 += w * r;        /* компенсаційний доданок        */
             }
 
-            net.layers[curr_layer_idx].neurons[curr_neuron_idx].z = acc1 - acc2;
+            net.layers[ curr_layer_idx ].z[ curr_neuron_idx ] = acc1 - acc2;
+
+            if (net_deferred_activation) continue;
 
             /* активації без змін */
-            net.layers[curr_layer_idx].neurons[curr_neuron_idx].a =
-                net.layers[curr_layer_idx].neurons[curr_neuron_idx].z;
+            net.layers[ curr_layer_idx ].a[ curr_neuron_idx ] =
+                net.layers[ curr_layer_idx ].z[ curr_neuron_idx ];
 
             if (curr_layer_idx < net.num_layers - 1) {
-                if (net.layers[curr_layer_idx].neurons[curr_neuron_idx].z < 0.0f) {
-                    net.layers[curr_layer_idx].neurons[curr_neuron_idx].a = 0.0f;
+                if (net.layers[ curr_layer_idx ].z[ curr_neuron_idx ] < 0.0f) {
+                    net.layers[ curr_layer_idx ].a[ curr_neuron_idx ] = 0.0f;
                 } else {
-                    net.layers[curr_layer_idx].neurons[curr_neuron_idx].a =
-                        net.layers[curr_layer_idx].neurons[curr_neuron_idx].z;
+                    net.layers[ curr_layer_idx ].a[ curr_neuron_idx ] =
+                        net.layers[ curr_layer_idx ].z[ curr_neuron_idx ];
                 }
             } else {
-                net.layers[curr_layer_idx].neurons[curr_neuron_idx].a =
-                    1.0f / (1.0f + expf(-net.layers[curr_layer_idx].neurons[curr_neuron_idx].z));
+                net.layers[ curr_layer_idx ].a[ curr_neuron_idx ] =
+                    output_sigmoidf(net.layers[ curr_layer_idx ].z[ curr_neuron_idx ]);
             }
         }
+        if (net_deferred_activation) {
+            activate_layer(net.layers[ curr_layer_idx ], net.layers[ curr_layer_idx ].num_neurons, curr_layer_idx == net.num_layers - 1);
+        }
     }
     return net;
 }
@@ -479,44 +868,51 @@ network forward_shuffled_masked_neuron(network net, float mask_scale) {
     volatile int curr_layer_idx, curr_neuron_idx, prev_layer_neuron_idx;
 
     for (curr_layer_idx = 1; curr_layer_idx < net.num_layers; curr_layer_idx++) {
+        MARK_LAYER(curr_layer_idx);
         int prev_layer_idx = curr_layer_idx - 1;
+        rng_fill_uniformf(mask_pool, net.layers[ curr_layer_idx ].num_neurons, -mask_scale, mask_scale);
 
         for (curr_neuron_idx = 0; curr_neuron_idx < net.layers[curr_layer_idx].num_neurons; curr_neuron_idx++) {
+            MARK_NEURON(curr_layer_idx, curr_neuron_idx);
 
-            float R = nn_rand_uniformf(-mask_scale, mask_scale);
-            net.layers[curr_layer_idx].neurons[curr_neuron_idx].z =
-                net.layers[curr_layer_idx].neurons[curr_neuron_idx].bias + R;
+            float R = mask_pool[ curr_neuron_idx ];
+            net.layers[ curr_layer_idx ].z[ curr_neuron_idx ] =
+                net.layers[ curr_layer_idx ].bias[ curr_neuron_idx ] + R;
 
             for (prev_layer_neuron_idx = 0;
                  prev_layer_neuron_idx < net.layers[prev_layer_idx].num_neurons;
                  prev_layer_neuron_idx++) {
 
-                int mul_index = net.layers[curr_layer_idx].neurons[curr_neuron_idx]
-                                    .mul_indices[prev_layer_neuron_idx];
+                int mul_index = net.layers[ curr_layer_idx ].mul_indices[ curr_neuron_idx * net.layers[ curr_layer_idx ].num_weights + prev_layer_neuron_idx ];
 
-                net.layers[curr_layer_idx].neurons[curr_neuron_idx].z +=
-                    net.layers[curr_layer_idx].neurons[curr_neuron_idx].weights[mul_index] *
-                    net.layers[prev_layer_idx].neurons[mul_index].a;
+                net.layers[ curr_layer_idx ].z[ curr_neuron_idx ] +=
+                    net.layers[ curr_layer_idx ].weights[ curr_neuron_idx * net.layers[ curr_layer_idx ].num_weights + mul_index ] *
+                    net.layers[ prev_layer_idx ].a[ mul_index ];
             }
 
-            net.layers[curr_layer_idx].neurons[curr_neuron_idx].z -= R;
+            net.layers[ curr_layer_idx ].z[ curr_neuron_idx ] -= R;
+
+            if (net_deferred_activation) continue;
 
             /* активації без змін */
-            net.layers[curr_layer_idx].neurons[curr_neuron_idx].a =
-                net.layers[curr_layer_idx].neurons[curr_neuron_idx].z;
+            net.layers[ curr_layer_idx ].a[ curr_neuron_idx ] =
+                net.layers[ curr_layer_idx ].z[ curr_neuron_idx ];
 
             if (curr_layer_idx < net.num_layers - 1) {
-                if (net.layers[curr_layer_idx].neurons[curr_neuron_idx].z < 0.0f) {
-                    net.layers[curr_layer_idx].neurons[curr_neuron_idx].a = 0.0f;
+                if (net.layers[ curr_layer_idx ].z[ curr_neuron_idx ] < 0.0f) {
+                    net.layers[ curr_layer_idx ].a[ curr_neuron_idx ] = 0.0f;
                 } else {
-                    net.layers[curr_layer_idx].neurons[curr_neuron_idx].a =
-                        net.layers[curr_layer_idx].neurons[curr_neuron_idx].z;
+                    net.layers[ curr_layer_idx ].a[ curr_neuron_idx ] =
+                        net.layers[ curr_layer_idx ].z[ curr_neuron_idx ];
                 }
             } else {
-                net.layers[curr_layer_idx].neurons[curr_neuron_idx].a =
-                    1.0f / (1.0f + expf(-net.layers[curr_layer_idx].neurons[curr_neuron_idx].z));
+                net.layers[ curr_layer_idx ].a[ curr_neuron_idx ] =
+                    output_sigmoidf(net.layers[ curr_layer_idx ].z[ curr_neuron_idx ]);
             }
         }
+        if (net_deferred_activation) {
+            activate_layer(net.layers[ curr_layer_idx ], net.layers[ curr_layer_idx ].num_neurons, curr_layer_idx == net.num_layers - 1);
+        }
     }
     return net;
 }
@@ -526,46 +922,555 @@ network forward_shuffled_masked_mul(network net, float mask_scale) {
     volatile int curr_layer_idx, curr_neuron_idx, prev_layer_neuron_idx;
 
     for (curr_layer_idx = 1; curr_layer_idx < net.num_layers; curr_layer_idx++) {
+        MARK_LAYER(curr_layer_idx);
         int prev_layer_idx = curr_layer_idx - 1;
+        rng_fill_uniformf(mask_pool, net.layers[ curr_layer_idx ].num_neurons * net.layers[ curr_layer_idx ].num_weights,
+                          -mask_scale, mask_scale);
 
         for (curr_neuron_idx = 0; curr_neuron_idx < net.layers[curr_layer_idx].num_neurons; curr_neuron_idx++) {
+            MARK_NEURON(curr_layer_idx, curr_neuron_idx);
 
-            float acc1 = net.layers[curr_layer_idx].neurons[curr_neuron_idx].bias;
+            float acc1 = net.layers[ curr_layer_idx ].bias[ curr_neuron_idx ];
             float acc2 = 0.0f;
 
             for (prev_layer_neuron_idx = 0;
                  prev_layer_neuron_idx < net.layers[prev_layer_idx].num_neurons;
                  prev_layer_neuron_idx++) {
 
-                int mul_index = net.layers[curr_layer_idx].neurons[curr_neuron_idx]
-                                    .mul_indices[prev_layer_neuron_idx];
+                int mul_index = net.layers[ curr_layer_idx ].mul_indices[ curr_neuron_idx * net.layers[ curr_layer_idx ].num_weights + prev_layer_neuron_idx ];
 
-                float w = net.layers[curr_layer_idx].neurons[curr_neuron_idx].weights[mul_index];
-                float a = net.layers[prev_layer_idx].neurons[mul_index].a;
-                float r = nn_rand_uniformf(-mask_scale, mask_scale);
+                float w = net.layers[ curr_layer_idx ].weights[ curr_neuron_idx * net.layers[ curr_layer_idx ].num_weights + mul_index ];
+                float a = net.layers[ prev_layer_idx ].a[ mul_index ];
+                float r = mask_pool[ curr_neuron_idx * net.layers[ curr_layer_idx ].num_weights + prev_layer_neuron_idx ];
 
                 acc1 += w * (a + r);
                 acc2 += w * r;
             }
 
-            net.layers[curr_layer_idx].neurons[curr_neuron_idx].z = acc1 - acc2;
+            net.layers[ curr_layer_idx ].z[ curr_neuron_idx ] = acc1 - acc2;
+
+            if (net_deferred_activation) continue;
 
             /* активації без змін */
-            net.layers[curr_layer_idx].neurons[curr_neuron_idx].a =
-                net.layers[curr_layer_idx].neurons[curr_neuron_idx].z;
+            net.layers[ curr_layer_idx ].a[ curr_neuron_idx ] =
+                net.layers[ curr_layer_idx ].z[ curr_neuron_idx ];
 
             if (curr_layer_idx < net.num_layers - 1) {
-                if (net.layers[curr_layer_idx].neurons[curr_neuron_idx].z < 0.0f) {
-                    net.layers[curr_layer_idx].neurons[curr_neuron_idx].a = 0.0f;
+                if (net.layers[ curr_layer_idx ].z[ curr_neuron_idx ] < 0.0f) {
+                    net.layers[ curr_layer_idx ].a[ curr_neuron_idx ] = 0.0f;
                 } else {
-                    net.layers[curr_layer_idx].neurons[curr_neuron_idx].a =
-                        net.layers[curr_layer_idx].neurons[curr_neuron_idx].z;
+                    net.layers[ curr_layer_idx ].a[ curr_neuron_idx ] =
+                        net.layers[ curr_layer_idx ].z[ curr_neuron_idx ];
                 }
             } else {
-                net.layers[curr_layer_idx].neurons[curr_neuron_idx].a =
-                    1.0f / (1.0f + expf(-net.layers[curr_layer_idx].neurons[curr_neuron_idx].z));
+                net.layers[ curr_layer_idx ].a[ curr_neuron_idx ] =
+                    output_sigmoidf(net.layers[ curr_layer_idx ].z[ curr_neuron_idx ]);
             }
         }
+        if (net_deferred_activation) {
+            activate_layer(net.layers[ curr_layer_idx ], net.layers[ curr_layer_idx ].num_neurons, curr_layer_idx == net.num_layers - 1);
+        }
+    }
+    return net;
+}
+
+
+/* =========================
+   Random dummy operations (scmd 12) - fake MACs on decoy operands, interleaved with the real ones
+   ========================= */
+
+#ifndef DUMMY_MACS_PER_NEURON
+#define DUMMY_MACS_PER_NEURON 4
+#endif
+// Room for dummy MACs per inference as a percentage of the real ones - sizes the buffers below, it bounds no time.
+// The cycle budget is DUMMY_MACS_CYCLE_BUDGET_PCT (network.h), applied once set_dummy_mac_budget() is calibrated.
+#ifndef DUMMY_MACS_STORAGE_PCT
+#define DUMMY_MACS_STORAGE_PCT 100
+#endif
+#define DUMMY_MACS_MAX (NET_TOTAL_WEIGHTS * DUMMY_MACS_STORAGE_PCT / 100)
+
+static struct {
+    int per_neuron;                                 // set_dummy_macs(), within the storage and the cycle budget
+    int requested;                                  // what set_dummy_macs() was asked for, re-capped by a new budget
+    int weighted_neurons;
+    uint32_t fixed_cycles;                          // what any dummies add at all (the decoy operands are drawn)
+    uint32_t cycles_per_dummy;                      // scheduling + forward cycles one dummy MAC adds, 0 = uncalibrated
+    uint32_t cycle_budget;                          // cycles per inference all dummies may add
+    // per neuron, num_weights + per_neuron steps in order: < num_weights is that input, the rest num_weights + decoy
+    int schedule[NET_TOTAL_WEIGHTS + DUMMY_MACS_MAX];
+    int schedule_offset[NET_NUM_LAYERS];
+    float decoy_w[DUMMY_MACS_MAX + 1];
+    float decoy_a[DUMMY_MACS_MAX + 1];
+    float w_range[NET_NUM_LAYERS];                  // decoy weights are drawn within +-max |w| of their layer
+} dummy_macs;
+
+// where the dummy accumulators go, so the compiler has to compute them
+static volatile float dummy_sink;
+
+static void dummy_macs_init(network net) {
+    dummy_macs.weighted_neurons = 0;
+    for (int i = 1; i < net.num_layers; i++){
+        layer lay = net.layers[i];
+        dummy_macs.weighted_neurons += lay.num_neurons;
+        dummy_macs.w_range[i] = 0.0f;
+        for (int k = 0; k < lay.num_neurons * lay.num_weights; k++){
+            if (fabsf(lay.weights[k]) > dummy_macs.w_range[i]) dummy_macs.w_range[i] = fabsf(lay.weights[k]);
+        }
+    }
+    set_dummy_macs(DUMMY_MACS_PER_NEURON);
+}
+
+int set_dummy_macs(int per_neuron) {
+    const int neurons = dummy_macs.weighted_neurons > 0 ? dummy_macs.weighted_neurons : 1;
+    int most = DUMMY_MACS_MAX / neurons;
+    if (dummy_macs.cycles_per_dummy > 0){
+        const uint32_t affordable = dummy_macs.cycle_budget > dummy_macs.fixed_cycles
+            ? (dummy_macs.cycle_budget - dummy_macs.fixed_cycles) / (dummy_macs.cycles_per_dummy * (uint32_t)neurons)
+            : 0;
+        if ((uint32_t)most > affordable) most = (int)affordable;
+    }
+    dummy_macs.requested = per_neuron;
+    dummy_macs.per_neuron = per_neuron < 0 ? 0 : (per_neuron > most ? most : per_neuron);
+    return dummy_macs.per_neuron;
+}
+
+/*
+* The cycle budget: cycle_budget cycles per inference for all dummy MACs, their scheduling included, at fixed_cycles
+* for having any plus cycles_per_dummy for each (bench_calibrate_dummy_macs() measures them). 0 cycles_per_dummy drops
+* the budget and leaves only the storage cap. Re-caps the count set_dummy_macs() was last asked for.
+*/
+void set_dummy_mac_budget(uint32_t fixed_cycles, uint32_t cycles_per_dummy, uint32_t cycle_budget) {
+    dummy_macs.fixed_cycles = fixed_cycles;
+    dummy_macs.cycles_per_dummy = cycles_per_dummy;
+    dummy_macs.cycle_budget = cycle_budget;
+    set_dummy_macs(dummy_macs.requested);
+}
+
+int get_dummy_macs(void) {
+    return dummy_macs.per_neuron;
+}
+
+/*
+* Per trace, before the trigger: fresh decoy operands and, for every neuron, fresh random positions for its
+* per_neuron dummies among its num_weights + per_neuron steps (selection sampling - every subset equally likely,
+* the real MACs keep their order so z is bit-exact with forward()).
+*/
+network schedule_dummy_macs(network net) {
+    const int d = dummy_macs.per_neuron;
+    int s = 0, decoy = 0;
+    for (int i = 1; i < net.num_layers; i++){
+        const int nw = net.layers[i].num_weights;
+        dummy_macs.schedule_offset[i] = s;
+        rng_fill_uniformf(&dummy_macs.decoy_w[decoy], net.layers[i].num_neurons * d, -dummy_macs.w_range[i], dummy_macs.w_range[i]);
+        for (int j = 0; j < net.layers[i].num_neurons; j++){
+            int real = 0, need = d;
+            for (int p = 0; p < nw + d; p++){
+                if ((int)rng_below(nw + d - p) < need){
+                    dummy_macs.schedule[s++] = nw + decoy++;
+                    need--;
+                }
+                else{
+                    dummy_macs.schedule[s++] = real++;
+                }
+            }
+        }
+    }
+    // decoy activations in the range the capture notebook draws inputs from
+    rng_fill_uniformf(dummy_macs.decoy_a, decoy, -2.0f, 2.0f);
+    return net;
+}
+
+// Step of the current schedule at which input_idx of that neuron is multiplied - for bench_dummy_peak_share()
+int dummy_mac_step(network net, int layer_idx, int neuron_idx, int input_idx) {
+    const int steps = net.layers[layer_idx].num_weights + dummy_macs.per_neuron;
+    const int *row = &dummy_macs.schedule[dummy_macs.schedule_offset[layer_idx] + neuron_idx * steps];
+    for (int p = 0; p < steps; p++){
+        if (row[p] == input_idx) return p;
+    }
+    return -1;
+}
+
+/*
+* forward_layer() walking the schedule. A step is a dummy when its index is past the fan-in; that flag picks the
+* operand tables and the accumulator by indexing, not by branching, so a dummy MAC costs exactly what a real one does
+* and the real ones cannot be told apart by timing - unlike delay_jitter_cycles(), whose nop loops are visible.
+*/
+static inline __attribute__((always_inline)) void forward_dummy_layer(layer curr, layer prev, const int layer_idx, const int num_weights, const int num_neurons, const int is_output_layer, const int at_end){
+    const int steps = num_weights + dummy_macs.per_neuron;
+    const int *schedule = &dummy_macs.schedule[dummy_macs.schedule_offset[layer_idx]];
+    const float *a_table[2] = {prev.a, dummy_macs.decoy_a};
+    const int offset[2] = {0, num_weights};
+
+    volatile int curr_neuron_idx, step;
+
+    MARK_LAYER(layer_idx);
+    // for each neuron in this layer
+    for (curr_neuron_idx = 0; curr_neuron_idx < num_neurons; curr_neuron_idx++){
+        MARK_NEURON(layer_idx, curr_neuron_idx);
+        const float *w_table[2] = {&curr.weights[ curr_neuron_idx * num_weights ], dummy_macs.decoy_w};
+        const int *row = &schedule[ curr_neuron_idx * steps ];
+        float acc[2] = {curr.bias[ curr_neuron_idx ], 0.0f};
+
+        // the real multiplications in order, the dummies between them
+        for (step = 0; step < steps; step++){
+            const int idx = row[ step ];
+            const int dummy = idx >= num_weights;
+            const int k = idx - offset[ dummy ];
+            acc[ dummy ] = acc[ dummy ] + (w_table[ dummy ][ k ] * a_table[ dummy ][ k ]);
+        }
+        curr.z[ curr_neuron_idx ] = acc[0];
+        dummy_sink = acc[1];
+
+        if (at_end) continue;
+        //apply relu / sigmoid
+        if(!is_output_layer){
+            if((curr.z[ curr_neuron_idx ]) < 0)
+            {
+                curr.a[ curr_neuron_idx ] = 0;
+            }
+            else
+            {
+                curr.a[ curr_neuron_idx ] = curr.z[ curr_neuron_idx ];
+            }
+        }
+        else{
+            curr.a[ curr_neuron_idx ] = output_sigmoidf(curr.z[ curr_neuron_idx ]);
+        }
+    }
+    if (at_end) activate_layer(curr, num_neurons, is_output_layer);
+}
+
+network forward_dummy(network net) {
+    if (net_deferred_activation){
+        #define X(layer_idx, prev_layer_idx, num_weights, num_neurons) \
+            forward_dummy_layer(net.layers[ layer_idx ], net.layers[ prev_layer_idx ], layer_idx, num_weights, num_neurons, layer_idx == NET_NUM_LAYERS - 1, 1);
+        NET_CONFIG_LAYERS(X)
+        #undef X
+    }
+    else{
+        #define X(layer_idx, prev_layer_idx, num_weights, num_neurons) \
+            forward_dummy_layer(net.layers[ layer_idx ], net.layers[ prev_layer_idx ], layer_idx, num_weights, num_neurons, layer_idx == NET_NUM_LAYERS - 1, 0);
+        NET_CONFIG_LAYERS(X)
+        #undef X
+    }
+    return net;
+}
+
+
+/* =========================
+   MAC kernels - faster versions of forward(), selected with set_mac_kernel()
+   ========================= */
+
+// Row stride of the int16 weights - fan-in rounded up to even so SMLAD always reads whole pairs
+#define MAC_Q15_STRIDE(num_weights) (((num_weights) + 1) & ~1)
+#define NET_X_WEIGHTS_Q15(layer_idx, prev_layer_idx, num_weights, num_neurons) + MAC_Q15_STRIDE(num_weights) * (num_neurons)
+#define NET_TOTAL_WEIGHTS_Q15 (0 NET_CONFIG_LAYERS(NET_X_WEIGHTS_Q15))
+
+// Bits of magnitude given to the int16 weights; activations get 17 - log2(fan-in) so a whole dot product fits in 31 bits
+#define MAC_Q15_WEIGHT_BITS 13
+#define MAC_Q15_ACC_BITS 30
+
+#if defined(__FP_FAST_FMAF)
+#define MAC_FMA(a, b, acc) fmaf((a), (b), (acc))
+#else
+#define MAC_FMA(a, b, acc) ((a) * (b) + (acc))
+#endif
+
+static mac_kernel net_mac_kernel = MAC_KERNEL;
+
+static struct {
+    int16_t wq[NET_TOTAL_WEIGHTS_Q15];      // weights as int16, row-major [num_neurons][MAC_Q15_STRIDE(num_weights)]
+    int wq_offset[NET_NUM_LAYERS];
+    int wq_shift[NET_NUM_LAYERS];           // wq = w * 2^wq_shift
+    int act_bits[NET_NUM_LAYERS];           // magnitude bits for this layer's inputs
+    int16_t aq[NET_TOTAL_NEURONS + 1];      // quantized inputs of the current layer, zero padded to even
+} mac_q15;
+
+/*
+* Quantizes the weights for MAC_Q15_SMLAD, one power-of-two scale per layer. Called once from init_network().
+*/
+static void mac_kernels_init(network net) {
+    int offset = 0;
+    for (int i = 1; i < net.num_layers; i++){
+        layer lay = net.layers[i];
+        int stride = MAC_Q15_STRIDE(lay.num_weights);
+        float max_w = 0.0f;
+        for (int k = 0; k < lay.num_neurons * lay.num_weights; k++){
+            if (fabsf(lay.weights[k]) > max_w) max_w = fabsf(lay.weights[k]);
+        }
+        int e = 0;
+        frexpf(max_w, &e);                              // max_w < 2^e
+        mac_q15.wq_shift[i] = MAC_Q15_WEIGHT_BITS - e;
+
+        int fan_in_bits = 0;
+        while ((1 << fan_in_bits) < lay.num_weights) fan_in_bits++;
+        mac_q15.act_bits[i] = MAC_Q15_ACC_BITS - MAC_Q15_WEIGHT_BITS - fan_in_bits;
+        // max_a < 2^e, but lrintf() can still round the largest input up to 2^act_bits - keep that inside int16
+        if (mac_q15.act_bits[i] > 14) mac_q15.act_bits[i] = 14;
+
+        mac_q15.wq_offset[i] = offset;
+        for (int j = 0; j < lay.num_neurons; j++){
+            for (int k = 0; k < stride; k++){
+                mac_q15.wq[offset + j * stride + k] = (k < lay.num_weights)
+                    ? (int16_t)lrintf(ldexpf(lay.weights[j * lay.num_weights + k], mac_q15.wq_shift[i]))
+                    : 0;
+            }
+        }
+        offset += lay.num_neurons * stride;
+    }
+}
+
+void set_mac_kernel(mac_kernel kernel) {
+    net_mac_kernel = (kernel < MAC_NUM_KERNELS) ? kernel : MAC_REFERENCE;
+}
+
+mac_kernel get_mac_kernel(void) {
+    return net_mac_kernel;
+}
+
+const char *mac_kernel_name(mac_kernel kernel) {
+    switch (kernel) {
+        case MAC_REFERENCE:    return "reference";
+        case MAC_FMA_UNROLLED: return "fma_unrolled";
+        case MAC_Q15_SMLAD:    return "q15_smlad";
+        case MAC_SIMD:         return "simd";
+        default:               return "?";
+    }
+}
+
+/*
+* Plain registers, four independent accumulators and single-cycle VFMA on the M4F. The summation order differs
+* from forward(), so the last bit of z can too.
+*/
+static inline __attribute__((always_inline)) void forward_layer_fma(layer curr, layer prev, const int layer_idx, const int num_weights, const int num_neurons, const int is_output_layer){
+    MARK_LAYER(layer_idx);
+    for (int j = 0; j < num_neurons; j++){
+        MARK_NEURON(layer_idx, j);
+        const float *w = &curr.weights[j * num_weights];
+        const float *a = prev.a;
+        float acc0 = curr.bias[j], acc1 = 0, acc2 = 0, acc3 = 0;
+        int k = 0;
+        for (; k + 4 <= num_weights; k += 4){
+            acc0 = MAC_FMA(w[k],     a[k],     acc0);
+            acc1 = MAC_FMA(w[k + 1], a[k + 1], acc1);
+            acc2 = MAC_FMA(w[k + 2], a[k + 2], acc2);
+            acc3 = MAC_FMA(w[k + 3], a[k + 3], acc3);
+        }
+        for (; k < num_weights; k++){
+            acc0 = MAC_FMA(w[k], a[k], acc0);
+        }
+        curr.z[j] = (acc0 + acc1) + (acc2 + acc3);
+    }
+    activate_layer(curr, num_neurons, is_output_layer);
+}
+
+// acc + x.lo * y.lo + x.hi * y.hi - one SMLAD on the M4
+static inline int32_t mac_smlad(uint32_t x, uint32_t y, int32_t acc) {
+#if defined(__ARM_FEATURE_DSP)
+    __asm__ ("smlad %0, %1, %2, %3" : "=r" (acc) : "r" (x), "r" (y), "r" (acc));
+    return acc;
+#else
+    return acc + (int16_t)x * (int16_t)y + (int16_t)(x >> 16) * (int16_t)(y >> 16);
+#endif
+}
+
+/*
+* int16 x int16 -> int32 dot products, two MACs per SMLAD. The inputs are quantized per layer with a power-of-two
+* scale taken from their largest magnitude (block floating point), z is converted back to float with the bias.
+* Approximate - bench-host reports the output error next to the speedup.
+*/
+static inline __attribute__((always_inline)) void forward_layer_q15(layer curr, layer prev, const int layer_idx, const int num_weights, const int num_neurons, const int is_output_layer){
+    MARK_LAYER(layer_idx);
+    const int stride = MAC_Q15_STRIDE(num_weights);
+    const int16_t *wq = &mac_q15.wq[mac_q15.wq_offset[layer_idx]];
+    int16_t *aq = mac_q15.aq;
+
+    float max_a = 0.0f;
+    for (int k = 0; k < num_weights; k++){
+        if (fabsf(prev.a[k]) > max_a) max_a = fabsf(prev.a[k]);
+    }
+    int e = 0;
+    frexpf(max_a, &e);                                  // max_a < 2^e
+    const int a_shift = mac_q15.act_bits[layer_idx] - e;
+    const float a_scale = ldexpf(1.0f, a_shift);
+    const float z_scale = ldexpf(1.0f, -(a_shift + mac_q15.wq_shift[layer_idx]));
+
+    for (int k = 0; k < num_weights; k++){
+        aq[k] = (int16_t)lrintf(prev.a[k] * a_scale);
+    }
+    aq[num_weights] = 0;
+
+    for (int j = 0; j < num_neurons; j++){
+        MARK_NEURON(layer_idx, j);
+        const int16_t *w = &wq[j * stride];
+        int32_t acc = 0;
+        for (int k = 0; k < stride; k += 2){
+            uint32_t wp, ap;
+            memcpy(&wp, &w[k], sizeof(wp));
+            memcpy(&ap, &aq[k], sizeof(ap));
+            acc = mac_smlad(wp, ap, acc);
+        }
+        curr.z[j] = curr.bias[j] + (float)acc * z_scale;
+    }
+    activate_layer(curr, num_neurons, is_output_layer);
+}
+
+#if defined(__x86_64__) && (defined(HOST_BUILD) || defined(DEBUGGING))
+#include <immintrin.h>
+
+#define MAC_SIMD_HOST 1
+// Layers padded to whole 8-neuron blocks for the column-major AVX copy of the weights
+#define MAC_SIMD_ROWS(num_neurons) (((num_neurons) + 7) & ~7)
+#define NET_X_WEIGHTS_SIMD(layer_idx, prev_layer_idx, num_weights, num_neurons) + MAC_SIMD_ROWS(num_neurons) * (num_weights)
+#define NET_TOTAL_WEIGHTS_SIMD (0 NET_CONFIG_LAYERS(NET_X_WEIGHTS_SIMD))
+
+static struct {
+    float wt[NET_TOTAL_WEIGHTS_SIMD] __attribute__((aligned(32)));   // [num_weights][MAC_SIMD_ROWS(num_neurons)]
+    float zt[NET_TOTAL_NEURONS + 8] __attribute__((aligned(32)));
+    int wt_offset[NET_NUM_LAYERS];
+    int usable;
+} mac_simd;
+
+static void mac_simd_init(network net) {
+    int offset = 0;
+    mac_simd.usable = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    for (int i = 1; i < net.num_layers; i++){
+        layer lay = net.layers[i];
+        int rows = MAC_SIMD_ROWS(lay.num_neurons);
+        mac_simd.wt_offset[i] = offset;
+        for (int k = 0; k < lay.num_weights; k++){
+            for (int j = 0; j < rows; j++){
+                mac_simd.wt[offset + k * rows + j] = (j < lay.num_neurons) ? lay.weights[j * lay.num_weights + k] : 0.0f;
+            }
+        }
+        offset += rows * lay.num_weights;
+    }
+}
+
+/*
+* AVX2: eight neurons at once - broadcast one input, FMA it with a column of the transposed weights.
+* Vectorizing across neurons rather than along the fan-in keeps every lane busy for the 4/5/7 wide layers.
+*/
+static __attribute__((target("avx2,fma"))) void forward_layer_simd(layer curr, layer prev, const int layer_idx, const int num_weights, const int num_neurons){
+    const int rows = MAC_SIMD_ROWS(num_neurons);
+    const float *wt = &mac_simd.wt[mac_simd.wt_offset[layer_idx]];
+    for (int j = 0; j < rows; j += 8){
+        __m256 acc = _mm256_setzero_ps();
+        for (int k = 0; k < num_weights; k++){
+            acc = _mm256_fmadd_ps(_mm256_loadu_ps(&wt[k * rows + j]), _mm256_set1_ps(prev.a[k]), acc);
+        }
+        _mm256_store_ps(&mac_simd.zt[j], acc);
+    }
+    for (int j = 0; j < num_neurons; j++){
+        curr.z[j] = curr.bias[j] + mac_simd.zt[j];
+    }
+}
+#endif
+
+/*
+* forward() through the selected kernel. MAC_REFERENCE is forward() itself, the leakage reference - keep the
+* others out of the captures you compare against earlier campaigns.
+*/
+network forward_kernel(network net, mac_kernel kernel) {
+    switch (kernel) {
+        case MAC_FMA_UNROLLED:
+            #define X(layer_idx, prev_layer_idx, num_weights, num_neurons) \
+                forward_layer_fma(net.layers[ layer_idx ], net.layers[ prev_layer_idx ], layer_idx, num_weights, num_neurons, layer_idx == NET_NUM_LAYERS - 1);
+            NET_CONFIG_LAYERS(X)
+            #undef X
+            return net;
+
+        case MAC_Q15_SMLAD:
+            #define X(layer_idx, prev_layer_idx, num_weights, num_neurons) \
+                forward_layer_q15(net.layers[ layer_idx ], net.layers[ prev_layer_idx ], layer_idx, num_weights, num_neurons, layer_idx == NET_NUM_LAYERS - 1);
+            NET_CONFIG_LAYERS(X)
+            #undef X
+            return net;
+
+        case MAC_SIMD:
+#ifdef MAC_SIMD_HOST
+            if (mac_simd.usable){
+                #define X(layer_idx, prev_layer_idx, num_weights, num_neurons) \
+                    MARK_LAYER(layer_idx); \
+                    forward_layer_simd(net.layers[ layer_idx ], net.layers[ prev_layer_idx ], layer_idx, num_weights, num_neurons); \
+                    activate_layer(net.layers[ layer_idx ], num_neurons, layer_idx == NET_NUM_LAYERS - 1);
+                NET_CONFIG_LAYERS(X)
+                #undef X
+                return net;
+            }
+#endif
+            // no AVX2 here (or on the M4) - the unrolled FMA kernel is the widest we have
+            return forward_kernel(net, MAC_FMA_UNROLLED);
+
+        case MAC_REFERENCE:
+        default:
+            return forward(net);
+    }
+}
+
+
+/* =========================
+   scmd dispatch - shared by handle() and the benchmark
+   ========================= */
+
+// Per trace setup done before the trigger goes high
+network prepare_scmd(network net, uint8_t scmd) {
+    if (scmd == 1 || scmd == 4 || scmd == 5 || scmd == 7 || scmd == 9 || scmd == 10) {
+        net = shuffle_mul_indices_pooled(net);
+        //for (int i = 1; i < net.num_layers; i++) net = shuffle_mul_indices_deranged(net, i);
+    }
+    if (scmd >= 6 && scmd <= 9) {
+        qnetwork_load_input(qnet, net);
+    }
+    if (scmd == 10) {
+        for (int i = 1; i < net.num_layers; i++) net = shuffle_neuron_order(net, i);
+    }
+    if (scmd == 11) {
+        for (int i = 1; i < net.num_layers; i++) net = shuffle_mac_order(net, i);
+    }
+    if (scmd == 12) {
+        net = schedule_dummy_macs(net);
+    }
+    return net;
+}
+
+// The part inside the trigger window
+network forward_scmd(network net, uint8_t scmd, float mask_scale) {
+    switch (scmd) {
+        case 0: // unprotected - forward() unless set_mac_kernel() picked a faster kernel
+            return forward_kernel(net, net_mac_kernel);
+        case 1: // shuffled only
+            return forward_shuffled(net);
+        case 2: // masked (per neuron)
+            return forward_masked_neuron(net, mask_scale);
+        case 3: // masked (per multiply)
+            return forward_masked_mul(net, mask_scale);
+        case 4: // shuffled + masked (per neuron)
+            return forward_shuffled_masked_neuron(net, mask_scale);
+        case 5: // shuffled + masked (per multiply)
+            return forward_shuffled_masked_mul(net, mask_scale);
+        case 6: // fixed point, unprotected
+            qnet = qforward(qnet);
+            break;
+        case 7: // fixed point, shuffled
+            qnet = qforward_shuffled(qnet);
+            break;
+        case 8: // fixed point, masked mod 2^32 (per multiply)
+            qnet = qforward_masked_mul(qnet);
+            break;
+        case 9: // fixed point, shuffled + masked mod 2^32 (per multiply)
+            qnet = qforward_shuffled_masked_mul(qnet);
+            break;
+        case 10: // shuffled neuron order and multiplication order
+            return forward_neuron_shuffled(net);
+        case 11: // shuffled over the whole MAC grid of each layer
+            return forward_grid_shuffled(net);
+        case 12: // random dummy MACs between the real ones
+            return forward_dummy(net);
+        default: // fallback
+            return forward(net);
     }
+    // the fixed-point modes land here - hand their outputs back as float
+    qnetwork_store_output(qnet, net);
     return net;
 }
@@ -1,22 +1,31 @@
+#ifndef NETWORK_H
+#define NETWORK_H
+
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <time.h>
 
 void jitter_seed(uint32_t seed);
-
-typedef struct neuron_struct {
-    int num_weights;
-    float *weights;
-    float bias;
-    float z;
-    float a;
-
-    int *mul_indices; // the indices that dictate the order of multiplications
-} neuron;
-
+void jitter_enable(int enabled);
+
+/*
+* A layer is stored flat: the weights of all its neurons form one row-major [num_neurons][num_weights] matrix,
+* the z / a values are separate per-layer vectors (SoA) and the multiplication orders share one index pool.
+* Topology and weights come from network_config.h at build time - the weights point straight into the const
+* tables in flash, everything else lives in one statically sized arena inside network.c.
+*/
 typedef struct layer_struct {
     int num_neurons;
-    neuron *neurons;
+    int num_weights;      // fan-in - number of neurons in the previous layer (0 for the input layer)
+    const float *weights; // [num_neurons][num_weights]
+    float *bias;          // [num_neurons]
+    float *z;             // [num_neurons]
+    float *a;             // [num_neurons]
+
+    int *mul_indices;     // [num_neurons][num_weights] the indices that dictate the order of multiplications
+    int *neuron_order;    // [num_neurons] order the neurons are evaluated in (scmd 10)
+    int *mac_order;       // [num_neurons * num_weights] flat indices into weights, the order of the whole MAC grid (scmd 11)
 } layer;
 
 typedef struct network_struct {
@@ -26,26 +35,86 @@ typedef struct network_struct {
 
 //Utility functions
 void print_network(network net);
-void free_network(network *net);
 
 //Network control
-neuron create_neuron(void* weights, int num_out_weights, int layer_idx, int neuron_idx); //legacy - neuron create_neuron(int num_out_weights);
-layer create_layer(int num_neurons);
-network create_network(int num_layers);
-network init_network(int num_layers, int *num_neurons, void* weights);  //legacy - network construct_network(int num_outputs, int num_layers, int *num_neurons);
+network init_network(void);  //legacy - network init_network(int num_layers, int *num_neurons, void* weights);
+void reset_network(network net);
+//legacy - neuron create_neuron(void* weights, int num_out_weights, int layer_idx, int neuron_idx); layer create_layer(int num_neurons); network create_network(int num_layers);
 
 network shuffle_mul_indices(network net, int layer_idx);
 network shuffle_mul_indices_masked(network net, int layer_idx);
 network shuffle_mul_indices_deranged(network net, int layer_idx);
+network shuffle_mul_indices_pooled(network net);
+network shuffle_neuron_order(network net, int layer_idx);
+network shuffle_mac_order(network net, int layer_idx);
+int perm_pool_refill(network net, int max_slots);
 
 network forward(network net);   //legacy - void forward(network net);
 network forward_shuffled(network net);
+network forward_neuron_shuffled(network net);
+network forward_grid_shuffled(network net);
+
+// Random dummy operations (scmd 12): per_neuron fake MACs on decoy operands at random steps of every neuron.
+// Capped by the buffers (DUMMY_MACS_STORAGE_PCT percent of the real MACs) and by a cycle budget: the dummies and
+// their scheduling may add DUMMY_MACS_CYCLE_BUDGET_PCT percent to the cycles of a dummy-free scmd 12 trace, as
+// measured by bench_calibrate_dummy_macs(). set_dummy_macs() returns the count it kept.
+#ifndef DUMMY_MACS_CYCLE_BUDGET_PCT
+#define DUMMY_MACS_CYCLE_BUDGET_PCT 100
+#endif
+int set_dummy_macs(int per_neuron);
+void set_dummy_mac_budget(uint32_t fixed_cycles, uint32_t cycles_per_dummy, uint32_t cycle_budget);
+int get_dummy_macs(void);
+network schedule_dummy_macs(network net);
+int dummy_mac_step(network net, int layer_idx, int neuron_idx, int input_idx);
+network forward_dummy(network net);
+
+// MAC kernels for the unprotected forward pass (scmd 0). MAC_REFERENCE is forward() with its volatile counters.
+typedef enum {
+    MAC_REFERENCE = 0,
+    MAC_FMA_UNROLLED,   // register accumulators, unrolled by 4, VFMA on the M4F
+    MAC_Q15_SMLAD,      // int16 weights and inputs, two MACs per SMLAD (approximate)
+    MAC_SIMD,           // AVX2 on the host, falls back to MAC_FMA_UNROLLED elsewhere
+    MAC_NUM_KERNELS
+} mac_kernel;
+
+#ifndef MAC_KERNEL
+#define MAC_KERNEL MAC_REFERENCE
+#endif
+
+network forward_kernel(network net, mac_kernel kernel);
+void set_mac_kernel(mac_kernel kernel);
+mac_kernel get_mac_kernel(void);
+const char *mac_kernel_name(mac_kernel kernel);
+
+// Activations at the end of each layer (branchless ReLU over z) instead of after each neuron, for the float modes
+// 0-5, 10 and 12. The MAC kernels and scmd 11 always activate at the end.
+#ifndef DEFERRED_ACTIVATION
+#define DEFERRED_ACTIVATION 0
+#endif
+void set_deferred_activation(int enabled);
+int get_deferred_activation(void);
+
+// Branch-free table sigmoid instead of expf() on the output layer of the float modes (0-5, 10-12)
+#ifndef FAST_SIGMOID
+#define FAST_SIGMOID 0
+#endif
+void set_fast_sigmoid(int enabled);
+int get_fast_sigmoid(void);
+float fast_sigmoid(float z);
+
+// fisher_yates_masked() instead of fisher_yates() for the multiplication orders of scmd 1, 4, 5, 7, 9 and 10 - the
+// pool refills and the in-place shuffle when the pool is empty
+#ifndef MASKED_SHUFFLE
+#define MASKED_SHUFFLE 0
+#endif
+void set_masked_shuffle(int enabled);
+int get_masked_shuffle(void);
 
 //Random Shuffling
 void swap(int *a, int *b);
 void fisher_yates(int arr[], int size);
-void fisher_yates_masked(int arr[], unsigned int size, unsigned int s1[], unsigned int s2[], unsigned int length);
-unsigned int modulo_masked(int i, unsigned int s1[], unsigned int s2[], unsigned int length);
+void fisher_yates_masked(int arr[], int size);
+unsigned int modulo_masked(unsigned int n);     // uniform in [0, n), drawn as two shares added at the end
 
 
 
@@ -70,3 +139,10 @@ network forward_masked_neuron(network net, float mask_scale);
 network forward_masked_mul(network net, float mask_scale);
 network forward_shuffled_masked_neuron(network net, float mask_scale);
 network forward_shuffled_masked_mul(network net, float mask_scale);
+
+// scmd modes understood by prepare_scmd() / forward_scmd()
+#define NET_NUM_SCMD 13   // 0-5 float, 6-9 fixed point (qnetwork.c), 10-11 neuron / MAC grid shuffling, 12 dummy MACs
+network prepare_scmd(network net, uint8_t scmd);
+network forward_scmd(network net, uint8_t scmd, float mask_scale);
+
+#endif
@@ -0,0 +1,193 @@
+#define NET_CONFIG_Q
+#include "qnetwork.h"
+#include "markers.h"
+#include "network_config.h"
+#include "rng.h"
+#include <math.h>
+
+#if NET_Q_FRAC_BITS < 4 || NET_Q_FRAC_BITS > 14
+#error "NET_Q_FRAC_BITS must be within 4..14 for qsigmoid()"
+#endif
+
+static struct {
+    qlayer layers[NET_NUM_LAYERS];
+    int32_t bias[NET_TOTAL_NEURONS];
+    int32_t z[NET_TOTAL_NEURONS];
+    int16_t a[NET_TOTAL_NEURONS];
+    uint32_t masks[NET_TOTAL_WEIGHTS];  // one layer's additive masks, drawn in one rng_fill_u32() call
+} qnet_arena;
+
+/*
+* sigmoid(x) in Q15 for x = -8 .. 8 in steps of 1/16 (257 entries, clamped to 32767).
+* Generated with round(32768 / (1 + exp(-(-8 + i / 16)))).
+*/
+static const int16_t qsigmoid_lut[257] = {
+       11,    12,    12,    13,    14,    15,    16,    17,    18,    19,    21,    22,    23,    25,    26,    28,
+       30,    32,    34,    36,    38,    41,    43,    46,    49,    52,    56,    59,    63,    67,    72,    76,
+       81,    86,    92,    98,   104,   111,   118,   125,   133,   142,   151,   161,   171,   182,   194,   206,
+      219,   233,   248,   264,   281,   299,   318,   338,   360,   383,   407,   433,   461,   490,   521,   554,
+      589,   627,   666,   708,   753,   800,   851,   904,   961,  1021,  1084,  1152,  1223,  1299,  1379,  1464,
+     1554,  1649,  1750,  1856,  1969,  2088,  2213,  2346,  2486,  2633,  2789,  2952,  3124,  3306,  3496,  3696,
+     3906,  4126,  4357,  4599,  4851,  5115,  5391,  5678,  5978,  6289,  6613,  6949,  7297,  7658,  8031,  8416,
+     8813,  9221,  9641, 10072, 10513, 10964, 11424, 11894, 12371, 12856, 13348, 13845, 14347, 14852, 15361, 15872,
+    16384, 16896, 17407, 17916, 18421, 18923, 19420, 19912, 20397, 20874, 21344, 21804, 22255, 22696, 23127, 23547,
+    23955, 24352, 24737, 25110, 25471, 25819, 26155, 26479, 26790, 27090, 27377, 27653, 27917, 28169, 28411, 28642,
+    28862, 29072, 29272, 29462, 29644, 29816, 29979, 30135, 30282, 30422, 30555, 30680, 30799, 30912, 31018, 31119,
+    31214, 31304, 31389, 31469, 31545, 31616, 31684, 31747, 31807, 31864, 31917, 31968, 32015, 32060, 32102, 32141,
+    32179, 32214, 32247, 32278, 32307, 32335, 32361, 32385, 32408, 32430, 32450, 32469, 32487, 32504, 32520, 32535,
+    32549, 32562, 32574, 32586, 32597, 32607, 32617, 32626, 32635, 32643, 32650, 32657, 32664, 32670, 32676, 32682,
+    32687, 32692, 32696, 32701, 32705, 32709, 32712, 32716, 32719, 32722, 32725, 32727, 32730, 32732, 32734, 32736,
+    32738, 32740, 32742, 32743, 32745, 32746, 32747, 32749, 32750, 32751, 32752, 32753, 32754, 32755, 32756, 32756,
+    32757,
+};
+
+qnetwork init_qnetwork(void) {
+    qnetwork qnet;
+    int *num_neurons = NET_NUM_NEURONS;
+    int neuron_offset = 0;
+
+    qnet.num_layers = NET_NUM_LAYERS;
+    qnet.frac_bits = NET_Q_FRAC_BITS;
+    qnet.layers = qnet_arena.layers;
+    for (int i = 0; i < NET_NUM_LAYERS; i++){
+        qlayer *lay = &qnet.layers[i];
+        lay->num_neurons = num_neurons[i];
+        lay->num_weights = (i > 0) ? num_neurons[i - 1] : 0;
+        lay->weights = net_config_layer_weights_q[i];
+        lay->bias = &qnet_arena.bias[neuron_offset];
+        lay->z = &qnet_arena.z[neuron_offset];
+        lay->a = &qnet_arena.a[neuron_offset];
+        lay->mul_indices = NULL;
+        for (int j = 0; j < lay->num_neurons; j++){
+            lay->bias[j] = 0;
+        }
+        neuron_offset += lay->num_neurons;
+    }
+    return qnet;
+}
+
+static inline int16_t qsaturate16(int32_t x) {
+    return (int16_t)(x > INT16_MAX ? INT16_MAX : (x < INT16_MIN ? INT16_MIN : x));
+}
+
+/*
+* Quantizes the float network's input layer and borrows its multiplication orders, so the shuffled variants use
+* whatever prepare_scmd() put there (perm_pool slot or in-place shuffle).
+*/
+void qnetwork_load_input(qnetwork qnet, network net) {
+    const float scale = (float)(1 << NET_Q_FRAC_BITS);
+    for (int k = 0; k < qnet.layers[0].num_neurons; k++){
+        qnet.layers[0].a[k] = qsaturate16(lrintf(net.layers[0].a[k] * scale));
+    }
+    for (int i = 1; i < qnet.num_layers; i++){
+        qnet.layers[i].mul_indices = net.layers[i].mul_indices;
+    }
+}
+
+// Writes the output layer back as float, so callers read results from the float network either way
+void qnetwork_store_output(qnetwork qnet, network net) {
+    const float scale = 1.0f / (float)(1 << NET_Q_FRAC_BITS);
+    const int last = qnet.num_layers - 1;
+    for (int j = 0; j < qnet.layers[last].num_neurons; j++){
+        net.layers[last].z[j] = (float)qnet.layers[last].z[j] * scale;
+        net.layers[last].a[j] = (float)qnet.layers[last].a[j] * scale;
+    }
+}
+
+/*
+* z and the result in Q(frac_bits). Linear interpolation between the 1/16 steps of the table, saturating outside -8..8.
+*/
+int32_t qsigmoid(int32_t z, int frac_bits) {
+    const int step_bits = frac_bits - 4;
+    int32_t t = z + (8 << frac_bits);
+    int32_t y;
+    if (t <= 0){
+        y = qsigmoid_lut[0];
+    }
+    else if (t >= (16 << frac_bits)){
+        y = qsigmoid_lut[256];
+    }
+    else{
+        int32_t idx = t >> step_bits;
+        int32_t frac = t & ((1 << step_bits) - 1);
+        y = qsigmoid_lut[idx] + (((qsigmoid_lut[idx + 1] - qsigmoid_lut[idx]) * frac) >> step_bits);
+    }
+    return (y + (1 << (14 - frac_bits))) >> (15 - frac_bits);
+}
+
+/*
+* One layer of the fixed-point forward pass, instantiated per layer from NET_CONFIG_LAYERS and per variant:
+*  shuffled - visit the products in the borrowed mul_indices order
+*  masked   - every input a is replaced by the share a + r (mod 2^32) before it is multiplied, the sum of w * r is
+*             subtracted afterwards. Unlike the float masks this unmasks exactly.
+*/
+static inline __attribute__((always_inline)) void qforward_layer(qlayer curr, qlayer prev, const int layer_idx, const int num_weights, const int num_neurons, const int is_output_layer, const int shuffled, const int masked){
+    uint32_t *masks = qnet_arena.masks;
+    MARK_LAYER(layer_idx);
+    if (masked){
+        rng_fill_u32(masks, num_neurons * num_weights);
+    }
+
+    for (int j = 0; j < num_neurons; j++){
+        MARK_NEURON(layer_idx, j);
+        const int16_t *w = &curr.weights[j * num_weights];
+        uint32_t acc = (uint32_t)curr.bias[j];
+        uint32_t acc_mask = 0;
+
+        for (int k = 0; k < num_weights; k++){
+            int idx = shuffled ? curr.mul_indices[j * num_weights + k] : k;
+            uint32_t wk = (uint32_t)(int32_t)w[idx];
+            if (masked){
+                uint32_t r = masks[j * num_weights + k];
+                uint32_t a_share = (uint32_t)(int32_t)prev.a[idx] + r;
+                acc += wk * a_share;          // the sensitive multiplication - only sees the share
+                acc_mask += wk * r;
+            }
+            else{
+                acc += wk * (uint32_t)(int32_t)prev.a[idx];
+            }
+        }
+
+        int32_t sum = (int32_t)(acc - acc_mask);                                    // Q(2 * frac)
+        int32_t z = (sum + (1 << (NET_Q_FRAC_BITS - 1))) >> NET_Q_FRAC_BITS;        // Q(frac)
+        curr.z[j] = z;
+        if (!is_output_layer){
+            curr.a[j] = qsaturate16(z & ~(z >> 31));    // integer ReLU, no branch
+        }
+        else{
+            curr.a[j] = (int16_t)qsigmoid(z, NET_Q_FRAC_BITS);
+        }
+    }
+}
+
+qnetwork qforward(qnetwork qnet) {
+    #define X(layer_idx, prev_layer_idx, num_weights, num_neurons) \
+        qforward_layer(qnet.layers[ layer_idx ], qnet.layers[ prev_layer_idx ], layer_idx, num_weights, num_neurons, layer_idx == NET_NUM_LAYERS - 1, 0, 0);
+    NET_CONFIG_LAYERS(X)
+    #undef X
+    return qnet;
+}
+
+qnetwork qforward_shuffled(qnetwork qnet) {
+    #define X(layer_idx, prev_layer_idx, num_weights, num_neurons) \
+        qforward_layer(qnet.layers[ layer_idx ], qnet.layers[ prev_layer_idx ], layer_idx, num_weights, num_neurons, layer_idx == NET_NUM_LAYERS - 1, 1, 0);
+    NET_CONFIG_LAYERS(X)
+    #undef X
+    return qnet;
+}
+
+qnetwork qforward_masked_mul(qnetwork qnet) {
+    #define X(layer_idx, prev_layer_idx, num_weights, num_neurons) \
+        qforward_layer(qnet.layers[ layer_idx ], qnet.layers[ prev_layer_idx ], layer_idx, num_weights, num_neurons, layer_idx == NET_NUM_LAYERS - 1, 0, 1);
+    NET_CONFIG_LAYERS(X)
+    #undef X
+    return qnet;
+}
+
+qnetwork qforward_shuffled_masked_mul(qnetwork qnet) {
+    #define X(layer_idx, prev_layer_idx, num_weights, num_neurons) \
+        qforward_layer(qnet.layers[ layer_idx ], qnet.layers[ prev_layer_idx ], layer_idx, num_weights, num_neurons, layer_idx == NET_NUM_LAYERS - 1, 1, 1);
+    NET_CONFIG_LAYERS(X)
+    #undef X
+    return qnet;
+}
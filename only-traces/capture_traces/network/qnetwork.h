@@ -0,0 +1,40 @@
+#ifndef QNETWORK_H
+#define QNETWORK_H
+
+#include <stdint.h>
+#include "network.h"
+
+/*
+* Fixed-point twin of the float network, built from the same network_config.h.
+* Weights and activations are int16 in Q(NET_Q_FRAC_BITS) (picked per config), products accumulate in 32 bits,
+* ReLU is integer and the output sigmoid is a table lookup instead of exp().
+* Accumulation is done in uint32_t, i.e. mod 2^32 - that is what lets the masked variants unmask exactly.
+*/
+typedef struct qlayer_struct {
+    int num_neurons;
+    int num_weights;
+    const int16_t *weights; // [num_neurons][num_weights], Q(frac_bits), int16 tables in flash
+    int32_t *bias;          // Q(2 * frac_bits) - same scale as the raw accumulator
+    int32_t *z;             // Q(frac_bits)
+    int16_t *a;             // Q(frac_bits)
+    const int *mul_indices; // borrowed from the float network's layer - see qnetwork_load_input()
+} qlayer;
+
+typedef struct qnetwork_struct {
+    int num_layers;
+    int frac_bits;
+    qlayer *layers;
+} qnetwork;
+
+qnetwork init_qnetwork(void);
+void qnetwork_load_input(qnetwork qnet, network net);
+void qnetwork_store_output(qnetwork qnet, network net);
+
+qnetwork qforward(qnetwork qnet);
+qnetwork qforward_shuffled(qnetwork qnet);
+qnetwork qforward_masked_mul(qnetwork qnet);
+qnetwork qforward_shuffled_masked_mul(qnetwork qnet);
+
+int32_t qsigmoid(int32_t z, int frac_bits);
+
+#endif
@@ -0,0 +1,76 @@
+#include "rng.h"
+#include "cycles.h"
+
+rng_t rng_global = {{0x9E3779B9u, 0x243F6A88u, 0xB7E15162u, 0x7F4A7C15u}};
+
+// splitmix32 - spreads one seed word over the whole state (xoshiro must not start all zero)
+static uint32_t rng_splitmix32(uint32_t *x) {
+    uint32_t z = (*x += 0x9E3779B9u);
+    z = (z ^ (z >> 16)) * 0x85EBCA6Bu;
+    z = (z ^ (z >> 13)) * 0xC2B2AE35u;
+    return z ^ (z >> 16);
+}
+
+void rng_seed_stream(rng_t *rng, uint32_t seed) {
+    for (int i = 0; i < 4; i++)
+        rng->s[i] = rng_splitmix32(&seed);
+}
+
+void rng_seed(uint32_t seed) {
+    rng_seed_stream(&rng_global, seed);
+}
+
+/*
+* Folds an entropy word into the shared state. handle() calls it with the cycle counter on every command, so the
+* UART arrival jitter keeps feeding the stream.
+*/
+void rng_stir(uint32_t entropy) {
+    uint32_t x = entropy ^ rng_u32();
+    rng_global.s[0] ^= rng_splitmix32(&x);
+    rng_global.s[1] ^= rng_splitmix32(&x);
+    rng_next(&rng_global);
+}
+
+#if defined(HOST_BUILD) || defined(DEBUGGING)
+
+void rng_seed_device(void) {
+    uint64_t t = host_time_ns() ^ host_cycles();
+    rng_seed((uint32_t)t ^ (uint32_t)(t >> 32));
+}
+
+#else
+
+// STM32F3 96-bit unique device ID
+#define RNG_UID ((const volatile uint32_t *)0x1FFFF7ACu)
+
+/*
+* The STM32F3 has no TRNG peripheral, so there is nothing true-random to seed from. The UID makes every board's
+* stream different and the cycle counter adds whatever boot timing there is; rng_stir() then adds the command
+* timing at run time.
+*/
+void rng_seed_device(void) {
+    cycles_init();
+    rng_seed(RNG_UID[0] ^ cycles_now());
+    rng_stir(RNG_UID[1]);
+    rng_stir(RNG_UID[2]);
+}
+
+#endif
+
+/*
+* Bulk fills - a whole layer's draws in one call, so the per-element cost is just the inlined generator.
+*/
+void rng_fill_u32(uint32_t *out, int n) {
+    rng_t local = rng_global;
+    for (int i = 0; i < n; i++)
+        out[i] = rng_next(&local);
+    rng_global = local;
+}
+
+void rng_fill_uniformf(float *out, int n, float lo, float hi) {
+    rng_t local = rng_global;
+    const float scale = (hi - lo) * (1.0f / 16777216.0f);
+    for (int i = 0; i < n; i++)
+        out[i] = lo + (float)(rng_next(&local) >> 8) * scale;
+    rng_global = local;
+}
@@ -0,0 +1,66 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+/*
+* One PRNG for everything random in the firmware - shuffling, masks and jitter.
+* xoshiro128++ (Blackman & Vigna): 4 words of state, a handful of cycles per draw on the M4, no libc, no locks.
+* Not cryptographic - it only has to be unpredictable enough per trace that the shuffles and masks decorrelate.
+*
+* rng_global is the shared stream; jitter keeps its own rng_t so its per-trace reseeding does not touch it.
+*/
+typedef struct rng_struct {
+    uint32_t s[4];
+} rng_t;
+
+extern rng_t rng_global;
+
+void rng_seed_stream(rng_t *rng, uint32_t seed);
+void rng_seed(uint32_t seed);
+void rng_seed_device(void);     // best entropy the platform has - see rng.c
+void rng_stir(uint32_t entropy);
+
+void rng_fill_u32(uint32_t *out, int n);
+void rng_fill_uniformf(float *out, int n, float lo, float hi);
+
+static inline uint32_t rng_rotl(uint32_t x, int k) {
+    return (x << k) | (x >> (32 - k));
+}
+
+static inline uint32_t rng_next(rng_t *rng) {
+    uint32_t *s = rng->s;
+    const uint32_t result = rng_rotl(s[0] + s[3], 7) + s[0];
+    const uint32_t t = s[1] << 9;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rng_rotl(s[3], 11);
+    return result;
+}
+
+static inline uint32_t rng_u32(void) {
+    return rng_next(&rng_global);
+}
+
+/*
+* Uniform in [0, bound), bound >= 1, without % - bitmask rejection: draw in the smallest power of two covering
+* bound and retry when the draw is too large (fewer than 2 draws on average, unbiased).
+*/
+static inline uint32_t rng_below(uint32_t bound) {
+    const uint32_t mask = 0xFFFFFFFFu >> __builtin_clz((bound - 1) | 1);
+    uint32_t x;
+    do {
+        x = rng_u32() & mask;
+    } while (x >= bound);
+    return x;
+}
+
+// Uniform in [lo, hi), 24 bits of resolution
+static inline float rng_uniformf(float lo, float hi) {
+    return lo + (hi - lo) * ((float)(rng_u32() >> 8) * (1.0f / 16777216.0f));
+}
+
+#endif